@@ -0,0 +1,202 @@
+// move-only Buffer with alignment, zero fill and huge page construction modes
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <new>
+#include <string>
+#include <utility>
+
+#include <sys/mman.h>
+
+//! whether a new Buffer's content is left uninitialized or zero-filled
+enum class Fill { Uninitialized, Zero };
+
+//! A non-copyable move-only buffer which contains a "large" memory area with
+//! a guaranteed alignment. Regular buffers come from posix_memalign(), huge
+//! page buffers are mmap()ed directly, hence the buffer remembers how its
+//! memory must be freed.
+class Buffer {
+public:
+    //! alignment for avoiding false sharing and split SIMD loads
+    static constexpr size_t kCacheLine = 64;
+    //! alignment for O_DIRECT I/O and page-granular operations
+    static constexpr size_t kPage = 4096;
+    //! size and alignment of transparent huge pages on x86-64
+    static constexpr size_t kHugePage = 2 * 1024 * 1024;
+
+    //! allocate buffer containing n bytes, aligned to alignment bytes (a power
+    //! of two), and optionally zero-filled.
+    explicit Buffer(size_t n, size_t alignment = kCacheLine,
+                    Fill fill = Fill::Uninitialized)
+        : size_(n), mapped_(0) {
+        void* p;
+        if (alignment < sizeof(void*))
+            alignment = sizeof(void*);
+        if (posix_memalign(&p, alignment, n ? n : 1) != 0)
+            throw std::bad_alloc();
+        data_ = static_cast<char*>(p);
+        if (fill == Fill::Zero)
+            std::memset(data_, 0, n);
+    }
+
+    //! allocate buffer containing string str
+    explicit Buffer(const char* str) : Buffer(strlen(str)) {
+        std::copy(str, str + size_, data_);
+    }
+
+    //! allocate n bytes backed by huge pages, aligned to kHugePage. First
+    //! tries explicitly reserved huge pages (MAP_HUGETLB), then falls back to
+    //! asking for transparent huge pages. anonymous mappings are always
+    //! zero-filled by the kernel, hence no Fill parameter.
+    static Buffer huge_pages(size_t n) {
+        // an empty buffer owns no memory: nothing to map, and releasing it
+        // must not munmap() or free() anything but a null pointer.
+        if (n == 0)
+            return Buffer(nullptr, 0, 0);
+
+        size_t length = (n + kHugePage - 1) / kHugePage * kHugePage;
+
+        void* p = mmap(nullptr, length, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (p != MAP_FAILED)
+            return Buffer(static_cast<char*>(p), n, length);
+
+        // over-allocate by one huge page and trim both ends to get an aligned
+        // region, which the kernel can back with transparent huge pages.
+        char* q = static_cast<char*>(
+            mmap(nullptr, length + kHugePage, PROT_READ | PROT_WRITE,
+                 MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+        if (q == MAP_FAILED)
+            throw std::bad_alloc();
+
+        uintptr_t addr = reinterpret_cast<uintptr_t>(q);
+        size_t head = (kHugePage - addr % kHugePage) % kHugePage;
+        if (head != 0)
+            munmap(q, head);
+        munmap(q + head + length, kHugePage - head);
+
+        madvise(q + head, length, MADV_HUGEPAGE);
+        return Buffer(q + head, n, length);
+    }
+
+    //! non-copyable: delete copy-constructor
+    Buffer(const Buffer&) = delete;
+    //! non-copyable: delete assignment operator
+    Buffer& operator=(const Buffer&) = delete;
+
+    //! move-construct other buffer into this one
+    Buffer(Buffer&& other) noexcept
+        : data_(other.data_), size_(other.size_), mapped_(other.mapped_) {
+        other.data_ = nullptr;
+        other.size_ = 0;
+        other.mapped_ = 0;
+    }
+
+    //! move-assignment of other buffer into this one
+    Buffer& operator=(Buffer&& other) noexcept {
+        if (this == &other)
+            return *this;
+
+        release();
+        data_ = other.data_;
+        size_ = other.size_;
+        mapped_ = other.mapped_;
+        other.data_ = nullptr;
+        other.size_ = 0;
+        other.mapped_ = 0;
+
+        return *this;
+    }
+
+    //! delete buffer
+    ~Buffer() { release(); }
+
+    //! return as string
+    std::string to_string() const { return std::string(data_, size_); }
+
+    //! pointer to the buffer's memory
+    char* data() { return data_; }
+
+    //! pointer to the buffer's memory
+    const char* data() const { return data_; }
+
+    //! size of the buffer
+    size_t size() const { return size_; }
+
+    //! whether the buffer is backed by an mmap()ed huge page region
+    bool is_mapped() const { return mapped_ != 0; }
+
+private:
+    //! adopt an mmap()ed region of mapped bytes, or with mapped = 0 memory
+    //! which std::free() can release (including nullptr)
+    Buffer(char* data, size_t size, size_t mapped)
+        : data_(data), size_(size), mapped_(mapped) {}
+
+    //! free memory in the way it was allocated
+    void release() noexcept {
+        if (mapped_)
+            munmap(data_, mapped_);
+        else
+            std::free(data_);
+    }
+
+    //! the buffer
+    char* data_;
+    //! buffer size
+    size_t size_;
+    //! length of the mmap()ed region, or zero if from posix_memalign()
+    size_t mapped_;
+};
+
+//! checksum kernel which may assume 64-byte aligned input: the compiler can
+//! then use aligned vector loads without a scalar peeling prologue. b must be
+//! allocated with at least kCacheLine alignment, which is the default.
+uint64_t checksum_aligned(const Buffer& b) {
+    assert(reinterpret_cast<uintptr_t>(b.data()) % Buffer::kCacheLine == 0);
+    const uint64_t* p = static_cast<const uint64_t*>(
+        __builtin_assume_aligned(b.data(), Buffer::kCacheLine));
+    size_t n = b.size() / sizeof(uint64_t);
+
+    uint64_t sum = 0;
+    for (size_t i = 0; i < n; ++i)
+        sum += p[i];
+    return sum;
+}
+
+//! print address alignment of a buffer
+void print_alignment(const char* name, const Buffer& b) {
+    uintptr_t addr = reinterpret_cast<uintptr_t>(b.data());
+    std::cout << name << ": " << b.size() << " bytes"
+              << " cache-line aligned=" << (addr % Buffer::kCacheLine == 0)
+              << " page aligned=" << (addr % Buffer::kPage == 0)
+              << " huge page aligned=" << (addr % Buffer::kHugePage == 0)
+              << " mmap=" << b.is_mapped() << std::endl;
+}
+
+int main() {
+    Buffer line(1000);
+    print_alignment("cache line", line);
+
+    Buffer page(10000, Buffer::kPage, Fill::Zero);
+    print_alignment("page, zeroed", page);
+    std::cout << "zero checksum: " << checksum_aligned(page) << std::endl;
+
+    Buffer huge = Buffer::huge_pages(16 * 1024 * 1024);
+    print_alignment("huge pages", huge);
+
+    // fill and checksum the huge buffer, then move it around
+    std::memset(huge.data(), 1, huge.size());
+    Buffer moved = std::move(huge);
+    std::cout << "checksum: " << checksum_aligned(moved) << std::endl;
+
+    // empty huge page buffers own no memory
+    Buffer empty = Buffer::huge_pages(0);
+    std::cout << "empty: size " << empty.size()
+              << " mapped " << empty.is_mapped() << std::endl;
+
+    return 0;
+}
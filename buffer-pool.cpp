@@ -0,0 +1,307 @@
+// move-only Buffer backed by a pooled size-class slab allocator
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+/******************************************************************************/
+// Allocators: both provide static allocate(n) and deallocate(p, n). Buffer
+// always knows its size, hence the pool needs no per-block header.
+
+//! plain allocator calling global operator new/delete, as the original Buffer
+class NewAllocator {
+public:
+    static void* allocate(size_t n) { return operator new(n); }
+    static void deallocate(void* p, size_t /* n */) { operator delete(p); }
+};
+
+//! Size-class pool: requests are rounded up to the next power of two between
+//! kMinSize and kMaxSize. Each thread keeps a free list per size class, and
+//! refills it in batches from (or spills it to) a shared, mutex-protected free
+//! list. Only the shared pool ever carves new slabs from operator new, so the
+//! common allocation path is a pointer pop from a thread-local list.
+class PoolAllocator {
+public:
+    //! smallest block size (must hold a free list pointer)
+    static constexpr size_t kMinSize = 16;
+    //! largest pooled block size, larger requests go to operator new
+    static constexpr size_t kMaxSize = 4096;
+    //! number of size classes: 16, 32, ..., 4096
+    static constexpr size_t kNumClasses = 9;
+    //! size of a slab carved into blocks of one size class
+    static constexpr size_t kSlabSize = 64 * 1024;
+    //! number of blocks moved between thread-local and shared lists at once
+    static constexpr size_t kBatch = 64;
+
+    static void* allocate(size_t n) {
+        if (n > kMaxSize)
+            return operator new(n);
+        return ThreadCache::get().allocate(size_class(n));
+    }
+
+    static void deallocate(void* p, size_t n) {
+        if (p == nullptr)
+            return;
+        if (n > kMaxSize)
+            return operator delete(p);
+        ThreadCache::get().deallocate(size_class(n), p);
+    }
+
+    //! map a size to its class index: 0 for <= 16 bytes, 1 for <= 32, ...
+    static size_t size_class(size_t n) {
+        size_t c = 0;
+        while ((kMinSize << c) < n)
+            ++c;
+        return c;
+    }
+
+private:
+    //! free blocks are linked through their first bytes
+    struct FreeBlock {
+        FreeBlock* next;
+    };
+
+    //! singly-linked list of free blocks with a length counter
+    struct FreeList {
+        FreeBlock* head = nullptr;
+        size_t size = 0;
+
+        void push(void* p) {
+            FreeBlock* b = static_cast<FreeBlock*>(p);
+            b->next = head;
+            head = b;
+            ++size;
+        }
+
+        void* pop() {
+            FreeBlock* b = head;
+            head = b->next;
+            --size;
+            return b;
+        }
+    };
+
+    //! process-wide fallback: per-class free lists plus ownership of all slabs
+    class SharedPool {
+    public:
+        static SharedPool& get() {
+            static SharedPool pool;
+            return pool;
+        }
+
+        //! move up to kBatch blocks of class c into list, carving a new slab
+        //! if the shared list is empty.
+        void refill(size_t c, FreeList& list) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            FreeList& shared = lists_[c];
+            if (shared.head == nullptr)
+                carve_slab(c, shared);
+            for (size_t i = 0; i < kBatch && shared.head != nullptr; ++i)
+                list.push(shared.pop());
+        }
+
+        //! return count blocks from list back to the shared list of class c
+        void spill(size_t c, FreeList& list, size_t count) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            for (size_t i = 0; i < count && list.head != nullptr; ++i)
+                lists_[c].push(list.pop());
+        }
+
+        //! slabs are released only when the process ends
+        ~SharedPool() {
+            for (void* slab : slabs_)
+                operator delete(slab);
+        }
+
+    private:
+        SharedPool() = default;
+
+        void carve_slab(size_t c, FreeList& shared) {
+            size_t block = kMinSize << c;
+            char* slab = static_cast<char*>(operator new(kSlabSize));
+            slabs_.push_back(slab);
+            for (size_t off = 0; off + block <= kSlabSize; off += block)
+                shared.push(slab + off);
+        }
+
+        std::mutex mutex_;
+        FreeList lists_[kNumClasses];
+        std::vector<void*> slabs_;
+    };
+
+    //! per-thread free lists, returned to the shared pool on thread exit
+    class ThreadCache {
+    public:
+        static ThreadCache& get() {
+            static thread_local ThreadCache cache;
+            return cache;
+        }
+
+        void* allocate(size_t c) {
+            FreeList& list = lists_[c];
+            if (list.head == nullptr)
+                shared_.refill(c, list);
+            return list.pop();
+        }
+
+        void deallocate(size_t c, void* p) {
+            FreeList& list = lists_[c];
+            list.push(p);
+            // keep a bounded cache, e.g. if one thread only frees buffers
+            // allocated by another one.
+            if (list.size >= 2 * kBatch)
+                shared_.spill(c, list, kBatch);
+        }
+
+        ~ThreadCache() {
+            for (size_t c = 0; c < kNumClasses; ++c)
+                shared_.spill(c, lists_[c], lists_[c].size);
+        }
+
+    private:
+        //! taking the reference in the constructor guarantees that the shared
+        //! pool outlives all thread caches, including the main thread's.
+        ThreadCache() : shared_(SharedPool::get()) {}
+
+        SharedPool& shared_;
+        FreeList lists_[kNumClasses];
+    };
+};
+
+/******************************************************************************/
+
+//! A non-copyable move-only buffer which contains a "large" memory area. The
+//! memory is obtained from the Allocator template parameter.
+template <typename Allocator = NewAllocator>
+class Buffer {
+public:
+    //! allocate buffer containing n bytes
+    explicit Buffer(size_t n)
+        : data_(static_cast<char*>(Allocator::allocate(n))), size_(n) {}
+
+    //! allocate buffer containing string str
+    explicit Buffer(const char* str) : Buffer(strlen(str)) {
+        std::copy(str, str + size_, data_);
+    }
+
+    //! non-copyable: delete copy-constructor
+    Buffer(const Buffer&) = delete;
+    //! non-copyable: delete assignment operator
+    Buffer& operator=(const Buffer&) = delete;
+
+    //! move-construct other buffer into this one
+    Buffer(Buffer&& other) noexcept : data_(other.data_), size_(other.size_) {
+        other.data_ = nullptr;
+        other.size_ = 0;
+    }
+
+    //! move-assignment of other buffer into this one
+    Buffer& operator=(Buffer&& other) noexcept {
+        if (this == &other)
+            return *this;
+
+        Allocator::deallocate(data_, size_);
+        data_ = other.data_;
+        size_ = other.size_;
+        other.data_ = nullptr;
+        other.size_ = 0;
+
+        return *this;
+    }
+
+    //! delete buffer
+    ~Buffer() { Allocator::deallocate(data_, size_); }
+
+    //! return as string
+    std::string to_string() const { return std::string(data_, size_); }
+
+    //! pointer to the buffer's memory
+    char* data() { return data_; }
+
+    //! size of the buffer
+    size_t size() const { return size_; }
+
+private:
+    //! the buffer
+    char* data_;
+    //! buffer size
+    size_t size_;
+};
+
+//! the drop-in pooled buffer type
+using PooledBuffer = Buffer<PoolAllocator>;
+
+/******************************************************************************/
+
+//! churn many short-lived buffers of small sizes, keeping a window of live
+//! ones, like a message pipeline does. returns the elapsed seconds.
+template <typename BufferType>
+double churn(size_t rounds, size_t window) {
+    auto start = std::chrono::steady_clock::now();
+
+    std::vector<BufferType> live;
+    live.reserve(window);
+    uint32_t rng = 12345;
+
+    for (size_t i = 0; i < rounds; ++i) {
+        // cheap xorshift to vary sizes between 1 and 512 bytes
+        rng ^= rng << 13, rng ^= rng >> 17, rng ^= rng << 5;
+        BufferType b(1 + rng % 512);
+        b.data()[0] = static_cast<char>(i);
+
+        if (live.size() < window)
+            live.emplace_back(std::move(b));
+        else
+            live[rng % window] = std::move(b);
+    }
+
+    auto stop = std::chrono::steady_clock::now();
+    return std::chrono::duration<double>(stop - start).count();
+}
+
+int main() {
+    // the pooled buffer behaves exactly like the plain one
+    {
+        PooledBuffer b1("pooled buffer");
+        PooledBuffer b2 = std::move(b1);
+        std::cout << b2.to_string() << std::endl;
+
+        // large buffers bypass the pool
+        PooledBuffer big(1024 * 1024);
+        std::cout << "big buffer: " << big.size() << " bytes" << std::endl;
+    }
+
+    // compare allocation churn of operator new and the pool
+    {
+        const size_t rounds = 4 * 1000 * 1000, window = 1024;
+        std::cout << "operator new: " << churn<Buffer<NewAllocator> >(
+            rounds, window) << " s" << std::endl;
+        std::cout << "size-class pool: " << churn<PooledBuffer>(
+            rounds, window) << " s" << std::endl;
+    }
+
+    // buffers allocated on one thread may be freed on another: the blocks end
+    // up in the freeing thread's cache and spill back to the shared pool.
+    {
+        std::vector<PooledBuffer> buffers;
+        for (size_t i = 0; i < 1000; ++i)
+            buffers.emplace_back(100);
+
+        std::thread consumer([b = std::move(buffers)]() mutable {
+            b.clear();
+        });
+        consumer.join();
+
+        std::cout << "cross-thread free done" << std::endl;
+    }
+
+    return 0;
+}
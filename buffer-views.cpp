@@ -0,0 +1,143 @@
+// counting allocations: Buffer::to_string() versus a non-owning view
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <new>
+#include <streambuf>
+#include <string>
+#include <utility>
+
+/******************************************************************************/
+// Replace the global operator new/delete to count heap allocations.
+
+//! number of calls to operator new
+static size_t g_allocs = 0;
+
+void* operator new(size_t n) {
+    ++g_allocs;
+    if (void* p = std::malloc(n ? n : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+
+void operator delete(void* p, size_t /* n */) noexcept { std::free(p); }
+
+/******************************************************************************/
+
+//! A non-owning view of a contiguous array, as in move-only-buffer.cpp
+template <typename Type>
+class Span {
+public:
+    Span(Type* data, size_t size) : data_(data), size_(size) {}
+
+    Type* data() const { return data_; }
+    size_t size() const { return size_; }
+
+    Type* begin() const { return data_; }
+    Type* end() const { return data_ + size_; }
+
+    Type& operator [] (size_t i) const { return data_[i]; }
+
+private:
+    Type* data_;
+    size_t size_;
+};
+
+//! output a character view without copying it into a std::string first
+std::ostream& operator << (std::ostream& os, const Span<const char>& s) {
+    return os.write(s.data(), s.size());
+}
+
+//! A non-copyable move-only buffer which contains a "large" memory area
+class Buffer {
+public:
+    //! allocate buffer containing n bytes
+    explicit Buffer(size_t n)
+        : data_(reinterpret_cast<char*>(operator new(n))), size_(n) {}
+
+    //! non-copyable: delete copy-constructor
+    Buffer(const Buffer&) = delete;
+    //! non-copyable: delete assignment operator
+    Buffer& operator=(const Buffer&) = delete;
+
+    //! delete buffer
+    ~Buffer() { operator delete(data_); }
+
+    //! return as string: allocates and copies the whole content!
+    std::string to_string() const { return std::string(data_, size_); }
+
+    //! pointer to the buffer's memory
+    char* data() { return data_; }
+
+    //! return non-owning string_view-like view of the content
+    Span<const char> view() const { return Span<const char>(data_, size_); }
+
+private:
+    //! the buffer
+    char* data_;
+    //! buffer size
+    size_t size_;
+};
+
+/******************************************************************************/
+
+//! stream buffer discarding all output, such that only the cost of getting
+//! the bytes to the stream is measured.
+class NullStreamBuf : public std::streambuf {
+protected:
+    int_type overflow(int_type c) override { return c; }
+    std::streamsize xsputn(const char* /* s */, std::streamsize n) override {
+        return n;
+    }
+};
+
+//! old send path: stringify the buffer
+void send_string(std::ostream& os, const Buffer& b) {
+    os << b.to_string() << '\n';
+}
+
+//! new send path: output a view
+void send_view(std::ostream& os, const Buffer& b) {
+    os << b.view() << '\n';
+}
+
+//! run send function many times, report allocations and time per send
+template <typename SendFunction>
+void benchmark(const char* name, size_t size, SendFunction send) {
+    NullStreamBuf nullbuf;
+    std::ostream os(&nullbuf);
+
+    Buffer b(size);
+    std::memset(b.data(), 'x', size);
+
+    const size_t rounds = 1000000;
+    size_t allocs = g_allocs;
+    auto start = std::chrono::steady_clock::now();
+
+    for (size_t i = 0; i < rounds; ++i)
+        send(os, b);
+
+    auto stop = std::chrono::steady_clock::now();
+    allocs = g_allocs - allocs;
+    double ns = std::chrono::duration<double, std::nano>(stop - start).count();
+
+    std::cout << name << " size=" << size
+              << " allocs/send=" << static_cast<double>(allocs) / rounds
+              << " ns/send=" << ns / rounds << std::endl;
+}
+
+int main() {
+    // note that payloads fitting into std::string's SSO do not allocate
+    for (size_t size : { 8, 64, 1024, 65536 }) {
+        benchmark("to_string", size, send_string);
+        benchmark("view     ", size, send_view);
+    }
+
+    return 0;
+}
@@ -0,0 +1,186 @@
+// buffering FileIo decorator coalescing many small writes into large ones
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstddef>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <system_error>
+#include <utility>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+class FileIo
+{
+public:
+    virtual ~FileIo() = default;
+    virtual ssize_t write(const char* data, size_t size) = 0;
+    void write_string(const std::string& str) { write(str.data(), str.size()); }
+};
+
+class StdioFile final : public FileIo
+{
+public:
+    ssize_t write(const char* data, size_t size) final /* or: override */ {
+        std::cout.write(data, size);
+        return size;
+    }
+};
+
+//! FileIo writing to a file descriptor with one write() system call each
+class FdFile final : public FileIo
+{
+public:
+    explicit FdFile(int fd) : fd_(fd) {}
+
+    ssize_t write(const char* data, size_t size) final {
+        size_t done = 0;
+        while (done < size) {
+            ssize_t r = ::write(fd_, data + done, size - done);
+            if (r < 0) {
+                if (errno == EINTR)
+                    continue;
+                throw std::system_error(errno, std::system_category(),
+                                        "write");
+            }
+            done += r;
+        }
+        ++syscalls_;
+        return size;
+    }
+
+    //! number of write() calls issued
+    size_t syscalls() const { return syscalls_; }
+
+private:
+    int fd_;
+    size_t syscalls_ = 0;
+};
+
+//! A decorator which collects writes in a buffer and forwards them to the
+//! inner FileIo in large blocks: when the buffer is full, on explicit flush()
+//! and on destruction. Writes at least as large as the buffer bypass it. Since
+//! the class is final and redefines write_string(), calls through a
+//! BufferedFile pointer or reference are devirtualized and inlined, and a
+//! small write is only a memcpy().
+class BufferedFile final : public FileIo
+{
+public:
+    //! default buffer size
+    static constexpr size_t kDefaultSize = 64 * 1024;
+
+    //! wrap inner, which must outlive this object
+    explicit BufferedFile(FileIo& inner, size_t buffer_size = kDefaultSize)
+        : inner_(inner), buffer_(new char[buffer_size]),
+          capacity_(buffer_size) {}
+
+    //! non-copyable: delete copy-constructor
+    BufferedFile(const BufferedFile&) = delete;
+    //! non-copyable: delete assignment operator
+    BufferedFile& operator=(const BufferedFile&) = delete;
+
+    //! flush remaining data. errors cannot be reported from a destructor,
+    //! call flush() explicitly to see them.
+    ~BufferedFile() {
+        try {
+            flush();
+        }
+        catch (...) { }
+    }
+
+    ssize_t write(const char* data, size_t size) final {
+        if (size <= capacity_ - size_) {
+            // fast path: append to buffer
+            std::memcpy(buffer_.get() + size_, data, size);
+            size_ += size;
+            return size;
+        }
+        flush();
+        if (size >= capacity_)
+            return inner_.write(data, size);
+        std::memcpy(buffer_.get(), data, size);
+        size_ = size;
+        return size;
+    }
+
+    //! hides FileIo::write_string(), which calls write() through the virtual
+    //! table: this one calls the final write() directly.
+    void write_string(const std::string& str) { write(str.data(), str.size()); }
+
+    //! forward buffered data to the inner FileIo
+    void flush() {
+        if (size_ == 0)
+            return;
+        // reset before writing, such that a throwing write does not cause
+        // the data to be written again from the destructor.
+        size_t size = size_;
+        size_ = 0;
+        inner_.write(buffer_.get(), size);
+    }
+
+private:
+    //! the decorated FileIo
+    FileIo& inner_;
+    //! the buffer
+    std::unique_ptr<char[]> buffer_;
+    //! buffer size
+    size_t capacity_;
+    //! filled bytes in buffer
+    size_t size_ = 0;
+};
+
+//! write many small records, returns nanoseconds per record
+template <typename File>
+double benchmark(File& file, size_t records) {
+    const std::string record = "a small log record of about 40 bytes...\n";
+
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < records; ++i)
+        file.write_string(record);
+    auto stop = std::chrono::steady_clock::now();
+
+    return std::chrono::duration<double, std::nano>(stop - start).count()
+           / records;
+}
+
+int main()
+{
+    // buffered output to stdout: three writes, one std::cout.write()
+    {
+        StdioFile out;
+        BufferedFile buffered(out);
+        buffered.write_string("hello ");
+        buffered.write_string("buffered ");
+        buffered.write_string("world\n");
+    }
+
+    // compare one system call per record with buffered output
+    int fd = open("/dev/null", O_WRONLY | O_CLOEXEC);
+    if (fd < 0)
+        return 1;
+
+    const size_t records = 1000000;
+    {
+        FdFile file(fd);
+        double ns = benchmark(file, records);
+        std::cout << "unbuffered: " << ns << " ns/record, "
+                  << file.syscalls() << " write() calls" << std::endl;
+    }
+    {
+        FdFile file(fd);
+        double ns;
+        {
+            BufferedFile buffered(file);
+            ns = benchmark(buffered, records);
+        }
+        std::cout << "buffered:   " << ns << " ns/record, "
+                  << file.syscalls() << " write() calls" << std::endl;
+    }
+
+    close(fd);
+    return 0;
+}
@@ -0,0 +1,402 @@
+// FileIo decorator streaming output through an LZ4-style block compressor
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <sys/types.h>
+
+class FileIo
+{
+public:
+    virtual ~FileIo() = default;
+    virtual ssize_t write(const char* data, size_t size) = 0;
+    void write_string(const std::string& str) { write(str.data(), str.size()); }
+};
+
+//! FileIo collecting all data in memory
+class MemoryFile final : public FileIo
+{
+public:
+    ssize_t write(const char* data, size_t size) final {
+        data_.insert(data_.end(), data, data + size);
+        return size;
+    }
+
+    const std::vector<char>& data() const { return data_; }
+
+private:
+    std::vector<char> data_;
+};
+
+/******************************************************************************/
+// A small LZ77 compressor in the style of LZ4. The output is a sequence of
+// (literals, match) pairs. Each starts with a token byte: the high nibble is
+// the literal length, the low nibble the match length minus 4; a nibble of 15
+// is continued by bytes of 255 and a final byte < 255. Then follow the literal
+// bytes and the match offset (two bytes, little endian). The last sequence
+// has only literals. Matches are found with a hash table of 4-byte prefixes,
+// which makes compression a single pass and decompression mostly memcpy().
+
+namespace lz {
+
+//! minimum match length
+static constexpr size_t kMinMatch = 4;
+//! maximum match distance
+static constexpr size_t kMaxOffset = 65535;
+//! log2 of the hash table size
+static constexpr unsigned kHashBits = 12;
+
+//! maximum compressed size of n input bytes
+inline size_t bound(size_t n) { return n + n / 255 + 16; }
+
+inline uint32_t read32(const uint8_t* p) {
+    uint32_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+inline uint32_t hash(uint32_t v) {
+    return (v * 2654435761u) >> (32 - kHashBits);
+}
+
+//! write a length continuation: bytes of 255 and a final remainder
+inline uint8_t* write_length(uint8_t* op, size_t len) {
+    for ( ; len >= 255; len -= 255)
+        *op++ = 255;
+    *op++ = static_cast<uint8_t>(len);
+    return op;
+}
+
+//! emit one sequence; offset and match_len are ignored if match_len is zero
+inline uint8_t* write_sequence(
+    uint8_t* op, const uint8_t* literals, size_t lit_len,
+    size_t offset, size_t match_len) {
+    size_t m = match_len ? match_len - kMinMatch : 0;
+    *op++ = static_cast<uint8_t>(
+        (std::min<size_t>(lit_len, 15) << 4) | std::min<size_t>(m, 15));
+    if (lit_len >= 15)
+        op = write_length(op, lit_len - 15);
+    std::memcpy(op, literals, lit_len);
+    op += lit_len;
+    if (match_len) {
+        *op++ = static_cast<uint8_t>(offset);
+        *op++ = static_cast<uint8_t>(offset >> 8);
+        if (m >= 15)
+            op = write_length(op, m - 15);
+    }
+    return op;
+}
+
+//! compress n bytes from src into dst, which must hold bound(n) bytes.
+//! returns the compressed size.
+inline size_t compress(const char* source, size_t n, char* dest) {
+    const uint8_t* src = reinterpret_cast<const uint8_t*>(source);
+    uint8_t* op = reinterpret_cast<uint8_t*>(dest);
+
+    // positions + 1 of the last occurrence of each hashed 4-byte prefix
+    uint32_t table[1 << kHashBits] = { 0 };
+
+    size_t ip = 0, anchor = 0;
+    while (n >= kMinMatch && ip <= n - kMinMatch) {
+        uint32_t seq = read32(src + ip);
+        uint32_t& entry = table[hash(seq)];
+        size_t cand = entry;
+        entry = static_cast<uint32_t>(ip + 1);
+
+        if (cand == 0 || ip + 1 - cand > kMaxOffset ||
+            read32(src + cand - 1) != seq) {
+            ++ip;
+            continue;
+        }
+        --cand;
+
+        size_t len = kMinMatch;
+        while (ip + len < n && src[cand + len] == src[ip + len])
+            ++len;
+
+        op = write_sequence(op, src + anchor, ip - anchor, ip - cand, len);
+        ip += len;
+        anchor = ip;
+    }
+
+    op = write_sequence(op, src + anchor, n - anchor, 0, 0);
+    return op - reinterpret_cast<uint8_t*>(dest);
+}
+
+//! read a length continuation
+inline size_t read_length(const uint8_t*& ip, const uint8_t* end) {
+    size_t len = 0;
+    uint8_t b;
+    do {
+        if (ip == end)
+            throw std::runtime_error("lz: truncated length");
+        b = *ip++;
+        len += b;
+    } while (b == 255);
+    return len;
+}
+
+//! decompress n bytes from src, appending the output to out. matches may
+//! only reference bytes of this block, not earlier contents of out.
+inline void decompress(const char* source, size_t n, std::vector<char>& out) {
+    const uint8_t* ip = reinterpret_cast<const uint8_t*>(source);
+    const uint8_t* end = ip + n;
+    const size_t block_start = out.size();
+
+    while (ip != end) {
+        uint8_t token = *ip++;
+
+        size_t lit_len = token >> 4;
+        if (lit_len == 15)
+            lit_len += read_length(ip, end);
+        if (static_cast<size_t>(end - ip) < lit_len)
+            throw std::runtime_error("lz: truncated literals");
+        out.insert(out.end(), ip, ip + lit_len);
+        ip += lit_len;
+
+        // the last sequence has no match
+        if (ip == end)
+            break;
+
+        if (end - ip < 2)
+            throw std::runtime_error("lz: truncated offset");
+        size_t offset = ip[0] | (ip[1] << 8);
+        ip += 2;
+        size_t match_len = token & 15;
+        if (match_len == 15)
+            match_len += read_length(ip, end);
+        match_len += kMinMatch;
+
+        if (offset == 0 || offset > out.size() - block_start)
+            throw std::runtime_error("lz: invalid offset");
+
+        size_t pos = out.size();
+        out.resize(pos + match_len);
+        char* dst = out.data() + pos;
+        const char* src = dst - offset;
+        if (offset >= match_len) {
+            std::memcpy(dst, src, match_len);
+        }
+        else {
+            // overlapping match, e.g. a run: copy byte-wise
+            for (size_t i = 0; i < match_len; ++i)
+                dst[i] = src[i];
+        }
+    }
+}
+
+} // namespace lz
+
+/******************************************************************************/
+
+//! A decorator which collects written data into blocks, compresses each block
+//! and forwards it to the inner FileIo. Every block is preceded by a header of
+//! two 32-bit little-endian words: the uncompressed size and the stored size,
+//! with the top bit set if the block was incompressible and is stored raw.
+//! Blocks are independent, hence the stream can be decompressed block by
+//! block with bounded memory.
+class CompressedFile final : public FileIo
+{
+public:
+    //! default uncompressed block size
+    static constexpr size_t kDefaultBlockSize = 64 * 1024;
+
+    //! wrap inner, which must outlive this object
+    explicit CompressedFile(FileIo& inner,
+                            size_t block_size = kDefaultBlockSize)
+        : inner_(inner), block_size_(block_size),
+          compressed_(8 + lz::bound(block_size)) {
+        block_.reserve(block_size);
+    }
+
+    //! non-copyable: delete copy-constructor
+    CompressedFile(const CompressedFile&) = delete;
+    //! non-copyable: delete assignment operator
+    CompressedFile& operator=(const CompressedFile&) = delete;
+
+    //! compress remaining data. call flush() explicitly to see errors.
+    ~CompressedFile() {
+        try {
+            flush();
+        }
+        catch (...) { }
+    }
+
+    ssize_t write(const char* data, size_t size) final {
+        size_t done = 0;
+        while (done < size) {
+            size_t n = std::min(size - done, block_size_ - block_.size());
+            block_.insert(block_.end(), data + done, data + done + n);
+            done += n;
+            if (block_.size() == block_size_)
+                flush();
+        }
+        return size;
+    }
+
+    //! compress and forward the current (partial) block
+    void flush() {
+        if (block_.empty())
+            return;
+
+        uint32_t raw_size = static_cast<uint32_t>(block_.size());
+        uint32_t stored = static_cast<uint32_t>(
+            lz::compress(block_.data(), block_.size(), &compressed_[8]));
+        if (stored >= raw_size) {
+            std::memcpy(&compressed_[8], block_.data(), raw_size);
+            stored = raw_size | kRawFlag;
+        }
+
+        put32(&compressed_[0], raw_size);
+        put32(&compressed_[4], stored);
+        inner_.write(compressed_.data(), 8 + (stored & ~kRawFlag));
+
+        bytes_in_ += raw_size;
+        bytes_out_ += 8 + (stored & ~kRawFlag);
+        block_.clear();
+    }
+
+    //! uncompressed bytes written so far
+    size_t bytes_in() const { return bytes_in_; }
+
+    //! compressed bytes forwarded so far
+    size_t bytes_out() const { return bytes_out_; }
+
+    //! decompress a whole stream produced by CompressedFile
+    static std::vector<char> decompress(const char* data, size_t size) {
+        std::vector<char> out;
+        size_t pos = 0;
+        while (pos != size) {
+            if (size - pos < 8)
+                throw std::runtime_error("truncated block header");
+            uint32_t raw_size = get32(data + pos);
+            uint32_t stored = get32(data + pos + 4);
+            size_t length = stored & ~kRawFlag;
+            pos += 8;
+            if (size - pos < length)
+                throw std::runtime_error("truncated block");
+
+            size_t before = out.size();
+            if (stored & kRawFlag)
+                out.insert(out.end(), data + pos, data + pos + length);
+            else
+                lz::decompress(data + pos, length, out);
+            if (out.size() - before != raw_size)
+                throw std::runtime_error("block size mismatch");
+            pos += length;
+        }
+        return out;
+    }
+
+private:
+    static constexpr uint32_t kRawFlag = 0x80000000u;
+
+    static void put32(char* p, uint32_t v) {
+        for (size_t i = 0; i < 4; ++i)
+            p[i] = static_cast<char>(v >> (8 * i));
+    }
+
+    static uint32_t get32(const char* p) {
+        uint32_t v = 0;
+        for (size_t i = 0; i < 4; ++i)
+            v |= static_cast<uint32_t>(static_cast<uint8_t>(p[i])) << (8 * i);
+        return v;
+    }
+
+    //! the decorated FileIo
+    FileIo& inner_;
+    //! uncompressed block size
+    size_t block_size_;
+    //! current uncompressed block
+    std::vector<char> block_;
+    //! output buffer for header and compressed block
+    std::vector<char> compressed_;
+    //! statistics
+    size_t bytes_in_ = 0, bytes_out_ = 0;
+};
+
+int main()
+{
+    // generate log-like text output
+    std::string text;
+    for (size_t i = 0; text.size() < 16 * 1024 * 1024; ++i) {
+        text += "2017-06-01 12:00:" + std::to_string(i % 60)
+                + " worker=" + std::to_string(i % 16)
+                + " processed request id=" + std::to_string(i)
+                + " status=OK bytes=" + std::to_string(i * 7 % 10000) + "\n";
+    }
+
+    MemoryFile memory;
+    auto start = std::chrono::steady_clock::now();
+    {
+        CompressedFile file(memory);
+        // write line by line, as a logger would
+        size_t pos = 0;
+        while (pos < text.size()) {
+            size_t eol = text.find('\n', pos) + 1;
+            file.write(text.data() + pos, eol - pos);
+            pos = eol;
+        }
+        file.flush();
+        std::cout << "compressed " << file.bytes_in() << " to "
+                  << file.bytes_out() << " bytes, ratio "
+                  << static_cast<double>(file.bytes_in()) / file.bytes_out()
+                  << std::endl;
+    }
+    auto middle = std::chrono::steady_clock::now();
+
+    std::vector<char> restored = CompressedFile::decompress(
+        memory.data().data(), memory.data().size());
+    auto stop = std::chrono::steady_clock::now();
+
+    double mib = text.size() / 1048576.0;
+    std::cout << "compress: "
+              << mib / std::chrono::duration<double>(middle - start).count()
+              << " MiB/s, decompress: "
+              << mib / std::chrono::duration<double>(stop - middle).count()
+              << " MiB/s, round trip "
+              << (std::string(restored.begin(), restored.end()) == text
+                  ? "ok" : "FAILED")
+              << std::endl;
+
+    // incompressible data is stored raw
+    {
+        MemoryFile random;
+        {
+            CompressedFile file(random);
+            uint32_t x = 1;
+            for (size_t i = 0; i < 100000; ++i) {
+                x ^= x << 13, x ^= x >> 17, x ^= x << 5;
+                file.write(reinterpret_cast<const char*>(&x), sizeof(x));
+            }
+        }
+        std::cout << "random: 400000 bytes stored as "
+                  << random.data().size() << " bytes" << std::endl;
+    }
+
+    // blocks are independent: a match reaching back into the previous block
+    // is rejected. block 1 is "abcd" stored raw, block 2 is a single match
+    // of length 4 at offset 4.
+    {
+        const char stream[] = {
+            4, 0, 0, 0, 4, 0, 0, '\x80', 'a', 'b', 'c', 'd',
+            4, 0, 0, 0, 3, 0, 0, 0, 0x00, 4, 0
+        };
+        try {
+            CompressedFile::decompress(stream, sizeof(stream));
+            std::cout << "cross-block match: accepted (WRONG)" << std::endl;
+        }
+        catch (std::runtime_error& e) {
+            std::cout << "cross-block match: " << e.what() << std::endl;
+        }
+    }
+
+    return 0;
+}
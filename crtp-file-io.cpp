@@ -0,0 +1,163 @@
+// static dispatch FileIo via CRTP versus virtual and final dispatch
+
+#include <chrono>
+#include <cstddef>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+
+#include <sys/types.h>
+
+/******************************************************************************/
+// dynamic dispatch, as in virtual-override-final.cpp
+
+class FileIo
+{
+public:
+    virtual ~FileIo() = default;
+    virtual ssize_t write(const char* data, size_t size) = 0;
+    void write_string(const std::string& str) { write(str.data(), str.size()); }
+};
+
+class StdioFile final : public FileIo
+{
+public:
+    ssize_t write(const char* data, size_t size) final /* or: override */ {
+        std::cout.write(data, size);
+        return size;
+    }
+};
+
+//! fixed-size in-memory sink, which wraps around when full. the write cost is
+//! small, hence dispatch overhead dominates the benchmark below.
+class MemoryFile final : public FileIo
+{
+public:
+    ssize_t write(const char* data, size_t size) final {
+        if (pos_ + size > sizeof(memory_))
+            pos_ = 0;
+        std::memcpy(memory_ + pos_, data, size);
+        pos_ += size;
+        return size;
+    }
+
+    size_t pos() const { return pos_; }
+
+private:
+    char memory_[64 * 1024];
+    size_t pos_ = 0;
+};
+
+/******************************************************************************/
+// static dispatch: the Curiously Recurring Template Pattern
+
+//! CRTP front end with the same interface as FileIo. Derived classes implement
+//! write_impl(), and FileIoCrtp<Derived>::write() calls it via a static_cast:
+//! the call is resolved at compile time and can always be inlined, no matter
+//! through which type the object is accessed. The price is that there is no
+//! common base type: code using it must be a template over Derived.
+template <typename Derived>
+class FileIoCrtp
+{
+public:
+    ssize_t write(const char* data, size_t size) {
+        return derived().write_impl(data, size);
+    }
+    void write_string(const std::string& str) { write(str.data(), str.size()); }
+
+protected:
+    //! only derived classes may be constructed and destroyed, which prevents
+    //! deleting a Derived through a FileIoCrtp pointer without a virtual
+    //! destructor.
+    FileIoCrtp() = default;
+    ~FileIoCrtp() = default;
+
+private:
+    Derived& derived() { return *static_cast<Derived*>(this); }
+};
+
+class StdioFileCrtp final : public FileIoCrtp<StdioFileCrtp>
+{
+public:
+    ssize_t write_impl(const char* data, size_t size) {
+        std::cout.write(data, size);
+        return size;
+    }
+};
+
+class MemoryFileCrtp final : public FileIoCrtp<MemoryFileCrtp>
+{
+public:
+    ssize_t write_impl(const char* data, size_t size) {
+        if (pos_ + size > sizeof(memory_))
+            pos_ = 0;
+        std::memcpy(memory_ + pos_, data, size);
+        pos_ += size;
+        return size;
+    }
+
+    size_t pos() const { return pos_; }
+
+private:
+    char memory_[64 * 1024];
+    size_t pos_ = 0;
+};
+
+//! generic code over the CRTP front end
+template <typename Derived>
+void greet(FileIoCrtp<Derived>& file) {
+    file.write_string("hello from CRTP\n");
+}
+
+/******************************************************************************/
+
+//! write many small records through a File pointer, return ns per record
+template <typename File>
+double benchmark(File* file, size_t records) {
+    const char record[] = "record 12345678\n";
+
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < records; ++i)
+        file->write(record, sizeof(record) - 1);
+    auto stop = std::chrono::steady_clock::now();
+
+    return std::chrono::duration<double, std::nano>(stop - start).count()
+           / records;
+}
+
+//! hide the dynamic type from the optimizer, as happens in real code where
+//! the object comes from a factory in another translation unit.
+__attribute__((noinline))
+FileIo* hide_type(FileIo* file) {
+    asm volatile ("" : "+r" (file));
+    return file;
+}
+
+int main()
+{
+    StdioFileCrtp out;
+    greet(out);
+
+    const size_t records = 100000000;
+
+    // virtual: only the FileIo base type is known at the call site
+    std::unique_ptr<MemoryFile> m1(new MemoryFile);
+    FileIo* base = hide_type(m1.get());
+    double t_virtual = benchmark(base, records);
+
+    // final: the static type is the final class, the call is devirtualized
+    std::unique_ptr<MemoryFile> m2(new MemoryFile);
+    double t_final = benchmark(m2.get(), records);
+
+    // CRTP: resolved at compile time
+    std::unique_ptr<MemoryFileCrtp> m3(new MemoryFileCrtp);
+    double t_crtp = benchmark(m3.get(), records);
+
+    std::cout << "ns/record: virtual=" << t_virtual
+              << " final=" << t_final << " crtp=" << t_crtp
+              << " (" << m1->pos() + m2->pos() + m3->pos() << ")"
+              << std::endl;
+
+    return 0;
+}
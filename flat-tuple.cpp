@@ -0,0 +1,210 @@
+// flat tuple with members reordered by alignment, compared to the recursive
+// VTClass and std::tuple
+
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+//! the recursive VTClass from variadic-templates.cpp: each level pads value_
+//! to the alignment of rest_, and the empty VTClass<> at the end takes a byte.
+template <typename... Types>
+class VTClass;
+
+template <typename Type, typename... Types>
+class VTClass<Type, Types...> {
+public:
+    VTClass(const Type& value, const Types&... rest)
+        : value_(value), rest_(rest...) {}
+
+    Type value_;
+
+    VTClass<Types...> rest_;
+};
+
+template <>
+class VTClass<> {};
+
+/******************************************************************************/
+// compile-time member ordering: sort the indices of Types by decreasing
+// alignment. Since every type's size is a multiple of its alignment, members
+// placed in this order need no padding between them, only at the end.
+
+//! permutation of N indices; one extra entry allows N = 0
+template <size_t N>
+struct Order {
+    size_t index[N + 1];
+};
+
+//! stable insertion sort of the indices of Types by decreasing alignment, as a
+//! C++14 constexpr function
+template <typename... Types>
+constexpr Order<sizeof...(Types)> sort_by_alignment() {
+    const size_t align[] = { alignof(Types)..., 0 };
+    Order<sizeof...(Types)> order{};
+    for (size_t i = 0; i < sizeof...(Types); ++i) {
+        size_t j = i;
+        while (j > 0 && align[order.index[j - 1]] < align[i]) {
+            order.index[j] = order.index[j - 1];
+            --j;
+        }
+        order.index[j] = i;
+    }
+    return order;
+}
+
+//! the storage slot of component index, the inverse permutation
+template <typename... Types>
+constexpr size_t slot_of(size_t index) {
+    Order<sizeof...(Types)> order = sort_by_alignment<Types...>();
+    size_t slot = 0;
+    while (order.index[slot] != index)
+        ++slot;
+    return slot;
+}
+
+//! storage of one component. the Slot number makes each base class distinct.
+template <size_t Slot, typename Type>
+struct FlatLeaf {
+    FlatLeaf() : value() {}
+    explicit FlatLeaf(const Type& v) : value(v) {}
+
+    Type value;
+};
+
+template <typename Slots, typename... Types>
+class FlatTupleStorage;
+
+//! all leaves are direct base classes in slot order: one flat pack expansion
+//! instead of a recursive chain. The Itanium C++ ABI lays out non-empty bases
+//! in declaration order.
+template <size_t... Slots, typename... Types>
+class FlatTupleStorage<std::index_sequence<Slots...>, Types...>
+    : public FlatLeaf<
+          Slots,
+          typename std::tuple_element<
+              sort_by_alignment<Types...>().index[Slots],
+              std::tuple<Types...> >::type>...
+{
+protected:
+    FlatTupleStorage() = default;
+
+    //! construct each slot from its component of args
+    template <typename Tuple>
+    explicit FlatTupleStorage(const Tuple& args)
+        : FlatLeaf<
+              Slots,
+              typename std::tuple_element<
+                  sort_by_alignment<Types...>().index[Slots],
+                  std::tuple<Types...> >::type>(
+              std::get<sort_by_alignment<Types...>().index[Slots]>(args))... {}
+};
+
+/******************************************************************************/
+
+//! A tuple of Types... whose members are stored ordered by alignment, hence
+//! with minimal padding, while get<I>() still uses the declared index order.
+template <typename... Types>
+class FlatTuple
+    : private FlatTupleStorage<std::index_sequence_for<Types...>, Types...>
+{
+    using Storage =
+        FlatTupleStorage<std::index_sequence_for<Types...>, Types...>;
+
+public:
+    static constexpr size_t size = sizeof...(Types);
+
+    //! type of component I
+    template <size_t I>
+    using element = typename std::tuple_element<I, std::tuple<Types...> >::type;
+
+    //! value-initialize all components
+    FlatTuple() = default;
+
+    //! construct from all components. Disabled for the empty FlatTuple<>,
+    //! where it would redeclare the default constructor.
+    template <size_t Size = sizeof...(Types),
+              typename = typename std::enable_if<(Size > 0)>::type>
+    explicit FlatTuple(const Types&... values)
+        : Storage(std::forward_as_tuple(values...)) {}
+
+    //! component I, independent of its storage position
+    template <size_t I>
+    element<I>& get() {
+        return static_cast<FlatLeaf<slot_of<Types...>(I), element<I> >&>(
+            *this).value;
+    }
+
+    template <size_t I>
+    const element<I>& get() const {
+        return static_cast<const FlatLeaf<slot_of<Types...>(I), element<I> >&>(
+            *this).value;
+    }
+};
+
+//! std::get-like access
+template <size_t I, typename... Types>
+typename FlatTuple<Types...>::template element<I>& get(FlatTuple<Types...>& t) {
+    return t.template get<I>();
+}
+
+template <size_t I, typename... Types>
+const typename FlatTuple<Types...>::template element<I>&
+get(const FlatTuple<Types...>& t) {
+    return t.template get<I>();
+}
+
+/******************************************************************************/
+// size report for record types, computed and checked during compilation
+
+template <typename... Types>
+struct LayoutReport {
+    static constexpr size_t flat = sizeof(FlatTuple<Types...>);
+    static constexpr size_t tuple = sizeof(std::tuple<Types...>);
+    static constexpr size_t vtclass = sizeof(VTClass<Types...>);
+
+    static_assert(flat <= tuple, "FlatTuple larger than std::tuple");
+    static_assert(flat <= vtclass, "FlatTuple larger than VTClass");
+
+    static void print(const char* name) {
+        std::cout << name << ": FlatTuple=" << flat << " std::tuple=" << tuple
+                  << " VTClass=" << vtclass << std::endl;
+    }
+};
+
+template <typename... Types>
+constexpr size_t LayoutReport<Types...>::flat;
+template <typename... Types>
+constexpr size_t LayoutReport<Types...>::tuple;
+template <typename... Types>
+constexpr size_t LayoutReport<Types...>::vtclass;
+
+int main() {
+    FlatTuple<char, double, char, int, std::string> t('a', 1.5, 'b', 42, "str");
+    get<0>(t) = 'A';
+    std::cout << get<0>(t) << " " << get<1>(t) << " " << get<2>(t) << " "
+              << get<3>(t) << " " << get<4>(t) << std::endl;
+
+    // the double and std::string are stored first, the chars last
+    auto offset = [&t](const void* p) {
+        return static_cast<const char*>(p) - reinterpret_cast<const char*>(&t);
+    };
+    std::cout << "offsets: char@" << offset(&get<0>(t))
+              << " double@" << offset(&get<1>(t))
+              << " int@" << offset(&get<3>(t)) << std::endl;
+
+    LayoutReport<char, double, char>::print("(char, double, char)");
+    LayoutReport<bool, int64_t, int16_t, bool, int32_t, char>::print(
+        "(bool, int64, int16, bool, int32, char)");
+    LayoutReport<char, int, char, int, char, int>::print(
+        "(char, int, char, int, char, int)");
+    LayoutReport<uint8_t, double, uint16_t, float, uint8_t>::print(
+        "(uint8, double, uint16, float, uint8)");
+    LayoutReport<int, int>::print("(int, int)");
+    LayoutReport<>::print("()");
+
+    return 0;
+}
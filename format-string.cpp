@@ -0,0 +1,370 @@
+// print with a format string which is parsed, split and checked against the
+// argument types at compile time
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+//! Output buffer which lives on the stack and only moves to the heap if the
+//! formatted output exceeds kStackSize bytes, as in variadic-format.cpp
+class FormatBuffer {
+public:
+    static constexpr size_t kStackSize = 512;
+
+    FormatBuffer() = default;
+
+    //! non-copyable: delete copy-constructor
+    FormatBuffer(const FormatBuffer&) = delete;
+    //! non-copyable: delete assignment operator
+    FormatBuffer& operator=(const FormatBuffer&) = delete;
+
+    //! return pointer to at least n writable bytes at the end
+    char* reserve(size_t n) {
+        if (size_ + n > capacity_)
+            grow(size_ + n);
+        return data_ + size_;
+    }
+
+    //! mark n bytes written at reserve()'s pointer as used
+    void commit(size_t n) { size_ += n; }
+
+    void append(const char* s, size_t n) {
+        std::memcpy(reserve(n), s, n);
+        commit(n);
+    }
+
+    void append(char c) {
+        *reserve(1) = c;
+        commit(1);
+    }
+
+    void clear() { size_ = 0; }
+
+    const char* data() const { return data_; }
+    size_t size() const { return size_; }
+
+private:
+    void grow(size_t n) {
+        size_t capacity = std::max(n, 2 * capacity_);
+        std::unique_ptr<char[]> heap(new char[capacity]);
+        std::memcpy(heap.get(), data_, size_);
+        heap_ = std::move(heap);
+        data_ = heap_.get();
+        capacity_ = capacity;
+    }
+
+    char stack_[kStackSize];
+    std::unique_ptr<char[]> heap_;
+    char* data_ = stack_;
+    size_t size_ = 0;
+    size_t capacity_ = kStackSize;
+};
+
+/******************************************************************************/
+// value conversion, a shorter version of the one in variadic-format.cpp
+
+//! write unsigned v backwards ending at end, return pointer to first digit
+inline char* format_digits(char* end, uint64_t v) {
+    do {
+        *--end = static_cast<char>('0' + v % 10);
+        v /= 10;
+    } while (v != 0);
+    return end;
+}
+
+template <typename Type>
+typename std::enable_if<std::is_integral<Type>::value>::type
+format_value(FormatBuffer& buf, const Type& value) {
+    char tmp[24];
+    char* end = tmp + sizeof(tmp);
+    uint64_t v = static_cast<uint64_t>(value);
+    bool negative = std::is_signed<Type>::value && value < 0;
+    if (negative)
+        v = ~v + 1;
+    char* begin = format_digits(end, v);
+    if (negative)
+        *--begin = '-';
+    buf.append(begin, end - begin);
+}
+
+inline void format_value(FormatBuffer& buf, char value) { buf.append(value); }
+
+inline void format_value(FormatBuffer& buf, double value) {
+    char* p = buf.reserve(32);
+    buf.commit(std::snprintf(p, 32, "%g", value));
+}
+
+inline void format_value(FormatBuffer& buf, const char* value) {
+    buf.append(value, std::strlen(value));
+}
+
+inline void format_value(FormatBuffer& buf, const std::string& value) {
+    buf.append(value.data(), value.size());
+}
+
+/******************************************************************************/
+// compile-time parser. A format string contains literal text, placeholders
+// "{}" for any argument or "{d}", "{f}", "{s}", "{c}" for integers, floating
+// point numbers, strings and characters, and "{{" and "}}" for literal braces.
+// The string is cut into pieces: literal runs and placeholders. All functions
+// are constexpr (C++14 relaxed constexpr allows loops and local variables),
+// hence they run inside the compiler when used in a constant expression.
+
+//! one piece of a parsed format string
+struct Piece {
+    //! literal text or placeholder
+    bool literal;
+    //! literal: position and length of the text in the format string
+    size_t begin, length;
+    //! placeholder: type character or 0 for any type
+    char spec;
+    //! placeholder: index of the argument
+    size_t arg;
+};
+
+//! summary of a parsed format string
+struct FormatInfo {
+    bool valid;
+    size_t pieces;
+    size_t args;
+};
+
+//! returned by next_piece() on syntax errors
+static constexpr size_t kInvalid = static_cast<size_t>(-1);
+
+constexpr bool valid_spec(char spec) {
+    return spec == 0 || spec == 'd' || spec == 'f' || spec == 's' ||
+           spec == 'c';
+}
+
+//! parse the piece starting at pos into p, whose argument index, if it is a
+//! placeholder, is arg. returns the position after it or kInvalid.
+constexpr size_t next_piece(const char* s, size_t pos, size_t arg, Piece& p) {
+    p.literal = true, p.begin = pos, p.length = 1, p.spec = 0, p.arg = 0;
+    if (s[pos] == '{' && s[pos + 1] == '{')
+        return pos + 2;
+    if (s[pos] == '}')
+        return s[pos + 1] == '}' ? pos + 2 : kInvalid;
+    if (s[pos] == '{') {
+        size_t i = pos + 1;
+        char spec = 0;
+        if (s[i] != '}' && s[i] != 0)
+            spec = s[i++];
+        if (s[i] != '}' || !valid_spec(spec))
+            return kInvalid;
+        p.literal = false, p.spec = spec, p.arg = arg;
+        return i + 1;
+    }
+    size_t i = pos;
+    while (s[i] != 0 && s[i] != '{' && s[i] != '}')
+        ++i;
+    p.length = i - pos;
+    return i;
+}
+
+//! check the format string, count pieces and placeholders
+constexpr FormatInfo scan_format(const char* s) {
+    FormatInfo info{ true, 0, 0 };
+    size_t pos = 0;
+    while (s[pos] != 0) {
+        Piece p{ true, 0, 0, 0, 0 };
+        pos = next_piece(s, pos, info.args, p);
+        if (pos == kInvalid) {
+            info.valid = false;
+            return info;
+        }
+        ++info.pieces;
+        if (!p.literal)
+            ++info.args;
+    }
+    return info;
+}
+
+//! return piece number n of a valid format string
+constexpr Piece nth_piece(const char* s, size_t n) {
+    Piece p{ true, 0, 0, 0, 0 };
+    size_t pos = 0, args = 0;
+    for (size_t i = 0; i <= n; ++i) {
+        pos = next_piece(s, pos, args, p);
+        if (!p.literal)
+            ++args;
+    }
+    return p;
+}
+
+//! return the type character of placeholder number arg, 0 if there is none
+constexpr char arg_spec(const char* s, size_t arg) {
+    Piece p{ true, 0, 0, 0, 0 };
+    size_t pos = 0, args = 0;
+    while (s[pos] != 0) {
+        pos = next_piece(s, pos, args, p);
+        if (pos == kInvalid)
+            return 0;
+        if (!p.literal && args++ == arg)
+            return p.spec;
+    }
+    return 0;
+}
+
+//! whether an argument of Type may be formatted by a placeholder with spec
+template <typename Type>
+constexpr bool spec_accepts(char spec) {
+    using T = typename std::decay<Type>::type;
+    return spec == 0 ||
+           (spec == 'd' && std::is_integral<T>::value &&
+            !std::is_same<T, char>::value && !std::is_same<T, bool>::value) ||
+           (spec == 'f' && std::is_floating_point<T>::value) ||
+           (spec == 's' && (std::is_same<T, const char*>::value ||
+                            std::is_same<T, char*>::value ||
+                            std::is_same<T, std::string>::value)) ||
+           (spec == 'c' && std::is_same<T, char>::value);
+}
+
+//! Wrap a string literal into a type: C++14 does not allow string literals as
+//! template arguments, but a local class can return it from a constexpr static
+//! method, and the class type carries the string into templates.
+#define FORMAT(s)                                                 \
+    [] {                                                          \
+        struct Format {                                           \
+            static constexpr const char* str() { return s; }      \
+        };                                                        \
+        return Format();                                          \
+    } ()
+
+/******************************************************************************/
+
+//! fails to compile if argument Index does not match its placeholder
+template <typename Format, size_t Index, typename Type>
+void check_arg() {
+    static_assert(spec_accepts<Type>(arg_spec(Format::str(), Index)),
+                  "format: argument type does not match its placeholder");
+}
+
+//! emit literal piece P: a memcpy() of a compile-time length
+template <typename Format, size_t P, typename Tuple>
+void emit_piece(FormatBuffer& buf, const Tuple&, std::true_type) {
+    constexpr Piece p = nth_piece(Format::str(), P);
+    buf.append(Format::str() + p.begin, p.length);
+}
+
+//! emit placeholder piece P: convert its argument
+template <typename Format, size_t P, typename Tuple>
+void emit_piece(FormatBuffer& buf, const Tuple& args, std::false_type) {
+    constexpr Piece p = nth_piece(Format::str(), P);
+    format_value(buf, std::get<p.arg>(args));
+}
+
+template <typename Format, typename Tuple, size_t... Ps>
+void emit_pieces(FormatBuffer& buf, const Tuple& args,
+                 std::index_sequence<Ps...>, std::true_type /* valid */) {
+    using VarForeachExpander = int[];
+    (void)VarForeachExpander{
+        0, (emit_piece<Format, Ps>(
+                buf, args, std::integral_constant<
+                    bool, nth_piece(Format::str(), Ps).literal>()), 0)...
+    };
+}
+
+//! invalid formats emit nothing, the static_asserts have already failed
+template <typename Format, typename Tuple, size_t... Ps>
+void emit_pieces(FormatBuffer&, const Tuple&,
+                 std::index_sequence<Ps...>, std::false_type) { }
+
+template <typename Format, typename... Types, size_t... Is>
+void check_args(std::index_sequence<Is...>) {
+    using VarForeachExpander = int[];
+    (void)VarForeachExpander{ 0, (check_arg<Format, Is, Types>(), 0)... };
+}
+
+//! format values into buf according to the format string type Format. The
+//! string is parsed and checked during compilation, at runtime only the
+//! literal pieces are copied and the values converted.
+template <typename Format, typename... Types>
+void format_to(FormatBuffer& buf, Format, const Types&... values) {
+    constexpr FormatInfo info = scan_format(Format::str());
+    static_assert(info.valid, "format: invalid format string");
+    static_assert(info.args == sizeof...(Types),
+                  "format: number of placeholders and arguments differ");
+    check_args<Format, Types...>(std::index_sequence_for<Types...>());
+
+    emit_pieces<Format>(
+        buf, std::forward_as_tuple(values...),
+        std::make_index_sequence<info.pieces>(),
+        std::integral_constant<
+            bool, info.valid && info.args == sizeof...(Types)>());
+}
+
+//! format into a std::string
+template <typename Format, typename... Types>
+std::string format(Format f, const Types&... values) {
+    FormatBuffer buf;
+    format_to(buf, f, values...);
+    return std::string(buf.data(), buf.size());
+}
+
+//! format and write to std::cout with a single write
+template <typename Format, typename... Types>
+void print(Format f, const Types&... values) {
+    FormatBuffer buf;
+    format_to(buf, f, values...);
+    std::cout.write(buf.data(), buf.size());
+}
+
+int main() {
+    print(FORMAT("hello {s}, {d} + {d} = {}\n"), "world", 1, 2, 3);
+    print(FORMAT("{} {f} {c} {{literal}}\n"), std::string("pi"), 3.14159, 'x');
+    std::cout << format(FORMAT("[{}]"), -42) << std::endl;
+
+    // the parser also works on plain constant expressions
+    static_assert(scan_format("a{}b{d}c").args == 2, "two placeholders");
+    static_assert(scan_format("a{}b{d}c").pieces == 5, "five pieces");
+    static_assert(!scan_format("a{x}").valid, "unknown placeholder type");
+    static_assert(!scan_format("a{").valid, "unterminated placeholder");
+    static_assert(!scan_format("a}b").valid, "single closing brace");
+
+    // each of these fails to compile:
+    // print(FORMAT("{d}\n"), 1.5);      // argument type does not match
+    // print(FORMAT("{} {}\n"), 1);      // number of placeholders differs
+    // print(FORMAT("{x}\n"), 1);        // invalid format string
+
+    // compare with snprintf(), which parses the format at runtime
+    const size_t rounds = 2000000;
+    size_t total = 0;
+
+    FormatBuffer buf;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < rounds; ++i) {
+        buf.clear();
+        format_to(buf, FORMAT("item {d} of {d}: {s} ({c})\n"),
+                  i, rounds, "name", 'x');
+        total += buf.size();
+    }
+    auto middle = std::chrono::steady_clock::now();
+
+    char out[256];
+    for (size_t i = 0; i < rounds; ++i) {
+        total += std::snprintf(out, sizeof(out), "item %zu of %zu: %s (%c)\n",
+                               i, rounds, "name", 'x');
+    }
+    auto stop = std::chrono::steady_clock::now();
+
+    std::cout << "ns/call: compile-time format="
+              << std::chrono::duration<double, std::nano>(
+                  middle - start).count() / rounds
+              << " snprintf="
+              << std::chrono::duration<double, std::nano>(
+                  stop - middle).count() / rounds
+              << " (" << total << " bytes)" << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,265 @@
+// move-only growable Buffer with amortized append, reserve and shrink_to_fit
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <new>
+#include <string>
+#include <utility>
+
+#include <sys/mman.h>
+
+//! A non-copyable move-only buffer with a capacity separate from its size,
+//! like std::vector<char>. Appending grows the capacity geometrically, hence
+//! it is amortized O(1) per byte. Small buffers live in malloc() memory and
+//! grow with realloc(), large ones are anonymous mappings which grow with
+//! mremap(): the kernel then moves page table entries instead of copying.
+class Buffer {
+public:
+    //! capacities from this size on are mmap()ed, smaller ones malloc()ed
+    static constexpr size_t kMapThreshold = 1024 * 1024;
+    //! page size used to round mapped capacities
+    static constexpr size_t kPage = 4096;
+
+    //! empty buffer without memory
+    Buffer() : data_(nullptr), size_(0), capacity_(0) {}
+
+    //! allocate buffer containing n bytes
+    explicit Buffer(size_t n) : Buffer() { resize(n); }
+
+    //! allocate buffer containing string str
+    explicit Buffer(const char* str) : Buffer() { append(str); }
+
+    //! non-copyable: delete copy-constructor
+    Buffer(const Buffer&) = delete;
+    //! non-copyable: delete assignment operator
+    Buffer& operator=(const Buffer&) = delete;
+
+    //! move-construct other buffer into this one
+    Buffer(Buffer&& other) noexcept
+        : data_(other.data_), size_(other.size_), capacity_(other.capacity_) {
+        other.data_ = nullptr;
+        other.size_ = other.capacity_ = 0;
+    }
+
+    //! move-assignment of other buffer into this one
+    Buffer& operator=(Buffer&& other) noexcept {
+        if (this == &other)
+            return *this;
+
+        release(data_, capacity_);
+        data_ = other.data_;
+        size_ = other.size_;
+        capacity_ = other.capacity_;
+        other.data_ = nullptr;
+        other.size_ = other.capacity_ = 0;
+
+        return *this;
+    }
+
+    //! delete buffer
+    ~Buffer() { release(data_, capacity_); }
+
+    //! ensure capacity for at least n bytes without further reallocation
+    void reserve(size_t n) {
+        if (n > capacity_)
+            reallocate(n);
+    }
+
+    //! change size to n bytes, new bytes are uninitialized
+    void resize(size_t n) {
+        reserve(n);
+        size_ = n;
+    }
+
+    //! append n bytes, growing the capacity geometrically. data may point
+    //! into this buffer, e.g. to append a copy of its content.
+    void append(const char* data, size_t n) {
+        if (size_ + n > capacity_) {
+            // reallocate() may move or free the source: remember its offset
+            bool inside = data_ != nullptr &&
+                          data >= data_ && data < data_ + size_;
+            size_t offset = inside ? data - data_ : 0;
+            reallocate(std::max(size_ + n, 2 * capacity_));
+            if (inside)
+                data = data_ + offset;
+        }
+        std::memcpy(data_ + size_, data, n);
+        size_ += n;
+    }
+
+    //! append a zero-terminated string
+    void append(const char* str) { append(str, strlen(str)); }
+
+    //! reduce the capacity to the size
+    void shrink_to_fit() {
+        if (size_ == 0) {
+            release(data_, capacity_);
+            data_ = nullptr;
+            capacity_ = 0;
+        }
+        else if (round_capacity(size_) < capacity_) {
+            reallocate(size_);
+        }
+    }
+
+    //! set size to zero, keeping the capacity
+    void clear() { size_ = 0; }
+
+    //! return as string
+    std::string to_string() const { return std::string(data_, size_); }
+
+    //! pointer to the buffer's memory
+    char* data() { return data_; }
+
+    //! size of the buffer
+    size_t size() const { return size_; }
+
+    //! allocated capacity of the buffer
+    size_t capacity() const { return capacity_; }
+
+private:
+    //! mapped capacities are multiples of the page size
+    static size_t round_capacity(size_t n) {
+        if (n < kMapThreshold)
+            return n;
+        return (n + kPage - 1) / kPage * kPage;
+    }
+
+    //! free memory of given capacity, whose size determines the allocator
+    static void release(char* data, size_t capacity) noexcept {
+        if (capacity >= kMapThreshold)
+            munmap(data, capacity);
+        else
+            std::free(data);
+    }
+
+    //! move content to memory of capacity n, which is at least size_
+    void reallocate(size_t n) {
+        n = round_capacity(n);
+        char* p;
+
+        if (n < kMapThreshold && capacity_ < kMapThreshold) {
+            // malloc() -> malloc(): realloc() may extend in place
+            p = static_cast<char*>(std::realloc(data_, n));
+            if (p == nullptr)
+                throw std::bad_alloc();
+        }
+        else if (n >= kMapThreshold && capacity_ >= kMapThreshold) {
+            // mmap() -> mmap(): mremap() remaps pages without copying
+            void* q = mremap(data_, capacity_, n, MREMAP_MAYMOVE);
+            if (q == MAP_FAILED)
+                throw std::bad_alloc();
+            p = static_cast<char*>(q);
+        }
+        else {
+            // crossing the threshold: allocate the other kind and copy
+            if (n >= kMapThreshold) {
+                void* q = mmap(nullptr, n, PROT_READ | PROT_WRITE,
+                               MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+                if (q == MAP_FAILED)
+                    throw std::bad_alloc();
+                p = static_cast<char*>(q);
+            }
+            else {
+                p = static_cast<char*>(std::malloc(n));
+                if (p == nullptr)
+                    throw std::bad_alloc();
+            }
+            std::memcpy(p, data_, size_);
+            release(data_, capacity_);
+        }
+
+        data_ = p;
+        capacity_ = n;
+    }
+
+    //! the buffer
+    char* data_;
+    //! used bytes
+    size_t size_;
+    //! allocated bytes
+    size_t capacity_;
+};
+
+//! the alternative without capacity: allocate a larger buffer and copy
+Buffer append_by_copy(Buffer&& b, const char* data, size_t n) {
+    Buffer r(b.size() + n);
+    std::memcpy(r.data(), b.data(), b.size());
+    std::memcpy(r.data() + b.size(), data, n);
+    return r;
+}
+
+int main() {
+    // incremental message assembly
+    {
+        Buffer msg;
+        msg.reserve(16);
+        msg.append("header|");
+        msg.append("body|");
+        msg.append("trailer");
+        std::cout << msg.to_string() << " size=" << msg.size()
+                  << " capacity=" << msg.capacity() << std::endl;
+
+        msg.shrink_to_fit();
+        std::cout << "after shrink_to_fit: capacity=" << msg.capacity()
+                  << std::endl;
+
+        // appending the buffer to itself reallocates the source
+        msg.append(msg.data(), msg.size());
+        std::cout << msg.to_string() << std::endl;
+    }
+
+    // build a 64 MiB payload from small records: capacity doublings cross
+    // into mremap() territory after 1 MiB.
+    {
+        const char record[] = "0123456789abcdefghijklmnopqrstuvwxyz|";
+        const size_t total = 64 * 1024 * 1024;
+
+        auto start = std::chrono::steady_clock::now();
+
+        Buffer b;
+        size_t reallocations = 0, capacity = 0;
+        while (b.size() < total) {
+            b.append(record, sizeof(record) - 1);
+            if (b.capacity() != capacity)
+                capacity = b.capacity(), ++reallocations;
+        }
+
+        auto stop = std::chrono::steady_clock::now();
+        double seconds = std::chrono::duration<double>(stop - start).count();
+
+        std::cout << "appended " << b.size() << " bytes with "
+                  << reallocations << " reallocations in " << seconds
+                  << " s, " << seconds * 1e9 / b.size() << " ns/byte"
+                  << std::endl;
+
+        b.resize(1000);
+        b.shrink_to_fit();
+        std::cout << "shrunk to capacity=" << b.capacity() << std::endl;
+    }
+
+    // compare: without capacity, each append reallocates and copies
+    {
+        const char record[] = "0123456789abcdefghijklmnopqrstuvwxyz|";
+        const size_t total = 256 * 1024;
+
+        auto start = std::chrono::steady_clock::now();
+
+        Buffer b;
+        while (b.size() < total)
+            b = append_by_copy(std::move(b), record, sizeof(record) - 1);
+
+        auto stop = std::chrono::steady_clock::now();
+        double seconds = std::chrono::duration<double>(stop - start).count();
+
+        std::cout << "append by copy: " << b.size() << " bytes in "
+                  << seconds << " s, " << seconds * 1e9 / b.size()
+                  << " ns/byte" << std::endl;
+    }
+
+    return 0;
+}
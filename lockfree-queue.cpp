@@ -0,0 +1,405 @@
+// bounded lock-free SPSC and MPMC queues moving Buffers between threads
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <new>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+//! A non-copyable move-only buffer which contains a "large" memory area
+class Buffer {
+public:
+    //! empty buffer, e.g. as target for a pop
+    Buffer() : data_(nullptr), size_(0) {}
+
+    //! allocate buffer containing n bytes
+    explicit Buffer(size_t n)
+        : data_(reinterpret_cast<char*>(operator new(n))), size_(n) {}
+
+    //! allocate buffer containing string str
+    explicit Buffer(const char* str) : Buffer(strlen(str)) {
+        std::copy(str, str + size_, data_);
+    }
+
+    //! non-copyable: delete copy-constructor
+    Buffer(const Buffer&) = delete;
+    //! non-copyable: delete assignment operator
+    Buffer& operator=(const Buffer&) = delete;
+
+    //! move-construct other buffer into this one
+    Buffer(Buffer&& other) noexcept : data_(other.data_), size_(other.size_) {
+        other.data_ = nullptr;
+        other.size_ = 0;
+    }
+
+    //! move-assignment of other buffer into this one
+    Buffer& operator=(Buffer&& other) noexcept {
+        if (this == &other)
+            return *this;
+
+        operator delete(data_);
+        data_ = other.data_;
+        size_ = other.size_;
+        other.data_ = nullptr;
+        other.size_ = 0;
+
+        return *this;
+    }
+
+    //! delete buffer
+    ~Buffer() { operator delete(data_); }
+
+    //! return as string
+    std::string to_string() const { return std::string(data_, size_); }
+
+    //! pointer to the buffer's memory
+    char* data() { return data_; }
+
+    //! size of the buffer
+    size_t size() const { return size_; }
+
+private:
+    //! the buffer
+    char* data_;
+    //! buffer size
+    size_t size_;
+};
+
+//! cache line size, used to keep producer and consumer state apart
+static constexpr size_t kCacheLine = 64;
+
+//! uninitialized storage for one element, constructed by push and destroyed
+//! by pop, or by the queue's destructor for elements left over. hence the
+//! queues need no default constructor of Type: it only has to be movable.
+template <typename Type>
+class Slot {
+public:
+    template <typename... Args>
+    void construct(Args&&... args) {
+        new (&storage_) Type(std::forward<Args>(args)...);
+    }
+
+    Type& get() { return *reinterpret_cast<Type*>(&storage_); }
+
+    void destroy() { get().~Type(); }
+
+private:
+    typename std::aligned_storage<sizeof(Type), alignof(Type)>::type storage_;
+};
+
+/******************************************************************************/
+
+//! Bounded single-producer single-consumer ring buffer. The producer only
+//! writes tail_, the consumer only writes head_, and each side caches the
+//! other's index to avoid touching the shared cache line on every operation.
+template <typename Type>
+class SpscQueue {
+public:
+    //! capacity is rounded up to a power of two
+    explicit SpscQueue(size_t capacity) {
+        size_t n = 1;
+        while (n < capacity)
+            n *= 2;
+        mask_ = n - 1;
+        slots_ = new Slot<Type>[n];
+    }
+
+    //! non-copyable: delete copy-constructor
+    SpscQueue(const SpscQueue&) = delete;
+    //! non-copyable: delete assignment operator
+    SpscQueue& operator=(const SpscQueue&) = delete;
+
+    //! destroy elements left in the queue in place. no other thread may
+    //! access the queue anymore.
+    ~SpscQueue() {
+        size_t tail = tail_.load(std::memory_order_acquire);
+        for (size_t pos = head_.load(std::memory_order_relaxed);
+             pos != tail; ++pos) {
+            slots_[pos & mask_].destroy();
+        }
+        delete[] slots_;
+    }
+
+    //! move value into the queue, if it is not full. value is untouched if
+    //! false is returned.
+    bool try_push(Type&& value) {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail - head_cache_ > mask_) {
+            head_cache_ = head_.load(std::memory_order_acquire);
+            if (tail - head_cache_ > mask_)
+                return false;
+        }
+        slots_[tail & mask_].construct(std::move(value));
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    //! move the front item into value, if the queue is not empty
+    bool try_pop(Type& value) {
+        size_t head = head_.load(std::memory_order_relaxed);
+        if (head == tail_cache_) {
+            tail_cache_ = tail_.load(std::memory_order_acquire);
+            if (head == tail_cache_)
+                return false;
+        }
+        Slot<Type>& slot = slots_[head & mask_];
+        value = std::move(slot.get());
+        slot.destroy();
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+private:
+    Slot<Type>* slots_;
+    size_t mask_;
+
+    //! producer's index and its cached copy of head_
+    alignas(kCacheLine) std::atomic<size_t> tail_ { 0 };
+    size_t head_cache_ = 0;
+
+    //! consumer's index and its cached copy of tail_
+    alignas(kCacheLine) std::atomic<size_t> head_ { 0 };
+    size_t tail_cache_ = 0;
+};
+
+/******************************************************************************/
+
+//! Bounded multi-producer multi-consumer queue after Dmitry Vyukov. Each slot
+//! carries a sequence number telling whether it is ready to be written in
+//! round k (seq == pos) or read (seq == pos + 1). Producers and consumers
+//! claim positions with a compare-and-swap on their respective counter.
+template <typename Type>
+class MpmcQueue {
+public:
+    //! capacity is rounded up to a power of two
+    explicit MpmcQueue(size_t capacity) {
+        size_t n = 1;
+        while (n < capacity)
+            n *= 2;
+        mask_ = n - 1;
+        cells_ = new Cell[n];
+        for (size_t i = 0; i < n; ++i)
+            cells_[i].seq.store(i, std::memory_order_relaxed);
+    }
+
+    //! non-copyable: delete copy-constructor
+    MpmcQueue(const MpmcQueue&) = delete;
+    //! non-copyable: delete assignment operator
+    MpmcQueue& operator=(const MpmcQueue&) = delete;
+
+    //! destroy elements left in the queue in place. no other thread may
+    //! access the queue anymore, hence all claimed positions between head_
+    //! and tail_ have been written.
+    ~MpmcQueue() {
+        size_t tail = tail_.load(std::memory_order_acquire);
+        for (size_t pos = head_.load(std::memory_order_relaxed);
+             pos != tail; ++pos) {
+            cells_[pos & mask_].slot.destroy();
+        }
+        delete[] cells_;
+    }
+
+    //! move value into the queue, if it is not full. value is untouched if
+    //! false is returned.
+    bool try_push(Type&& value) {
+        size_t pos = tail_.load(std::memory_order_relaxed);
+        for ( ; ; ) {
+            Cell& cell = cells_[pos & mask_];
+            size_t seq = cell.seq.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(seq - pos);
+            if (diff == 0) {
+                // slot is free in this round: try to claim it
+                if (tail_.compare_exchange_weak(
+                        pos, pos + 1, std::memory_order_relaxed)) {
+                    cell.slot.construct(std::move(value));
+                    cell.seq.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (diff < 0) {
+                // slot still holds last round's item: queue is full
+                return false;
+            }
+            else {
+                // another producer was faster, retry at the new tail
+                pos = tail_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    //! move the front item into value, if the queue is not empty
+    bool try_pop(Type& value) {
+        size_t pos = head_.load(std::memory_order_relaxed);
+        for ( ; ; ) {
+            Cell& cell = cells_[pos & mask_];
+            size_t seq = cell.seq.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(seq - (pos + 1));
+            if (diff == 0) {
+                if (head_.compare_exchange_weak(
+                        pos, pos + 1, std::memory_order_relaxed)) {
+                    value = std::move(cell.slot.get());
+                    cell.slot.destroy();
+                    // free the slot for the next round
+                    cell.seq.store(pos + mask_ + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (diff < 0) {
+                // slot not yet written: queue is empty
+                return false;
+            }
+            else {
+                pos = head_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+private:
+    struct Cell {
+        std::atomic<size_t> seq;
+        Slot<Type> slot;
+    };
+
+    Cell* cells_;
+    size_t mask_;
+
+    alignas(kCacheLine) std::atomic<size_t> tail_ { 0 };
+    alignas(kCacheLine) std::atomic<size_t> head_ { 0 };
+};
+
+/******************************************************************************/
+
+//! a move-only element type without default constructor, which counts live
+//! instances
+class Ticket {
+public:
+    explicit Ticket(int id) : id_(id) { ++live; }
+    Ticket(Ticket&& other) noexcept : id_(other.id_) { ++live; }
+    Ticket& operator=(Ticket&& other) noexcept {
+        id_ = other.id_;
+        return *this;
+    }
+    ~Ticket() { --live; }
+
+    int id() const { return id_; }
+
+    static int live;
+
+private:
+    int id_;
+};
+
+int Ticket::live = 0;
+
+//! push until it succeeds, yielding while the queue is full
+template <typename Queue>
+void push(Queue& q, Buffer&& b) {
+    while (!q.try_push(std::move(b)))
+        std::this_thread::yield();
+}
+
+//! pop until it succeeds, yielding while the queue is empty
+template <typename Queue>
+Buffer pop(Queue& q) {
+    Buffer b;
+    while (!q.try_pop(b))
+        std::this_thread::yield();
+    return b;
+}
+
+//! run pairs producers and pairs consumers which move items Buffers each
+//! through the queue, returns million Buffers per second.
+template <typename Queue>
+double benchmark(Queue& q, size_t pairs, size_t items) {
+    std::atomic<size_t> checksum { 0 };
+    std::vector<std::thread> threads;
+
+    auto start = std::chrono::steady_clock::now();
+
+    for (size_t p = 0; p < pairs; ++p) {
+        threads.emplace_back([&q, items]() {
+            for (size_t i = 0; i < items; ++i) {
+                Buffer b(64);
+                b.data()[0] = static_cast<char>(i);
+                push(q, std::move(b));
+            }
+        });
+        threads.emplace_back([&q, &checksum, items]() {
+            size_t sum = 0;
+            for (size_t i = 0; i < items; ++i)
+                sum += static_cast<unsigned char>(pop(q).data()[0]);
+            checksum += sum;
+        });
+    }
+    for (std::thread& t : threads)
+        t.join();
+
+    auto stop = std::chrono::steady_clock::now();
+    double seconds = std::chrono::duration<double>(stop - start).count();
+    return pairs * items / seconds / 1e6;
+}
+
+int main() {
+    // hand one Buffer to another thread: only the pointer crosses over
+    {
+        SpscQueue<Buffer> q(16);
+        Buffer b("buffer from main thread");
+        const char* raw = b.data();
+
+        push(q, std::move(b));
+        std::thread consumer([&q, raw]() {
+            Buffer r = pop(q);
+            std::cout << r.to_string() << ", same memory="
+                      << (r.data() == raw) << std::endl;
+        });
+        consumer.join();
+    }
+
+    // elements left in a queue are destroyed with it, without a default
+    // constructed temporary to pop into
+    {
+        {
+            SpscQueue<Ticket> spsc(4);
+            MpmcQueue<Ticket> mpmc(4);
+            for (int i = 0; i < 3; ++i) {
+                spsc.try_push(Ticket(i));
+                mpmc.try_push(Ticket(i));
+            }
+            Ticket t(-1);
+            mpmc.try_pop(t);
+            std::cout << "popped ticket " << t.id() << ", live tickets: "
+                      << Ticket::live << std::endl;
+        }
+        std::cout << "live tickets after destruction: " << Ticket::live
+                  << std::endl;
+    }
+
+    const size_t items = 200000;
+
+    // single producer/consumer pair
+    {
+        SpscQueue<Buffer> q(1024);
+        std::cout << "spsc 1 pair: " << benchmark(q, 1, items)
+                  << " M Buffers/s" << std::endl;
+    }
+
+    // scaling of the MPMC queue with 1..N pairs
+    size_t max_pairs = std::max(2u, std::thread::hardware_concurrency() / 2);
+    for (size_t pairs = 1; pairs <= max_pairs; pairs *= 2) {
+        MpmcQueue<Buffer> q(1024);
+        std::cout << "mpmc " << pairs << " pairs: "
+                  << benchmark(q, pairs, items) << " M Buffers/s"
+                  << std::endl;
+    }
+
+    return 0;
+}
@@ -0,0 +1,171 @@
+// move-only MappedBuffer whose storage is an mmap()ed file region
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <system_error>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+//! A non-copyable move-only read-only buffer mapping (a region of) a file
+//! into memory. Pages are loaded by the kernel on first access from the page
+//! cache, hence no read() into heap memory is needed. The file descriptor is
+//! closed right after mapping, the mapping stays valid until munmap().
+class MappedBuffer {
+public:
+    //! map length bytes of file path from offset on, or the rest of the file
+    //! if length is npos. offset need not be page-aligned.
+    explicit MappedBuffer(const char* path, size_t offset = 0,
+                          size_t length = npos) {
+        int fd = open(path, O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+            throw std::system_error(errno, std::system_category(), path);
+
+        struct stat st;
+        if (fstat(fd, &st) != 0) {
+            int err = errno;
+            close(fd);
+            throw std::system_error(err, std::system_category(), path);
+        }
+
+        size_t file_size = static_cast<size_t>(st.st_size);
+        offset = std::min(offset, file_size);
+        size_ = std::min(length, file_size - offset);
+
+        // mmap() requires a page-aligned file offset: map from the page
+        // boundary below and skip the difference.
+        size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+        size_t skip = offset % page;
+        map_size_ = skip + size_;
+
+        if (size_ == 0) {
+            // cannot mmap() zero bytes
+            map_ = nullptr;
+            data_ = nullptr;
+            close(fd);
+            return;
+        }
+
+        void* p = mmap(nullptr, map_size_, PROT_READ, MAP_PRIVATE, fd,
+                       static_cast<off_t>(offset - skip));
+        int err = errno;
+        close(fd);
+        if (p == MAP_FAILED)
+            throw std::system_error(err, std::system_category(), "mmap");
+
+        // tell the kernel to read ahead aggressively
+        madvise(p, map_size_, MADV_SEQUENTIAL);
+
+        map_ = static_cast<char*>(p);
+        data_ = map_ + skip;
+    }
+
+    //! non-copyable: delete copy-constructor
+    MappedBuffer(const MappedBuffer&) = delete;
+    //! non-copyable: delete assignment operator
+    MappedBuffer& operator=(const MappedBuffer&) = delete;
+
+    //! move-construct other buffer into this one
+    MappedBuffer(MappedBuffer&& other) noexcept
+        : map_(other.map_), map_size_(other.map_size_),
+          data_(other.data_), size_(other.size_) {
+        other.map_ = other.data_ = nullptr;
+        other.map_size_ = other.size_ = 0;
+    }
+
+    //! move-assignment of other buffer into this one
+    MappedBuffer& operator=(MappedBuffer&& other) noexcept {
+        if (this == &other)
+            return *this;
+
+        unmap();
+        map_ = other.map_;
+        map_size_ = other.map_size_;
+        data_ = other.data_;
+        size_ = other.size_;
+        other.map_ = other.data_ = nullptr;
+        other.map_size_ = other.size_ = 0;
+
+        return *this;
+    }
+
+    //! unmap buffer
+    ~MappedBuffer() { unmap(); }
+
+    //! return as string (copies!)
+    std::string to_string() const { return std::string(data_, size_); }
+
+    //! pointer to the mapped file content
+    const char* data() const { return data_; }
+
+    //! size of the mapped file region
+    size_t size() const { return size_; }
+
+    //! length parameter meaning "until the end of file"
+    static constexpr size_t npos = static_cast<size_t>(-1);
+
+private:
+    void unmap() noexcept {
+        if (map_)
+            munmap(map_, map_size_);
+    }
+
+    //! start of the page-aligned mapping
+    char* map_;
+    //! length of the mapping
+    size_t map_size_;
+    //! first byte of the requested region
+    char* data_;
+    //! length of the requested region
+    size_t size_;
+};
+
+//! send the buffer to a file descriptor directly from the mapping: the only
+//! copy left is the kernel's from the page cache to the destination.
+size_t send(int fd, const MappedBuffer& b) {
+    size_t done = 0;
+    while (done < b.size()) {
+        ssize_t r = write(fd, b.data() + done, b.size() - done);
+        if (r < 0) {
+            if (errno == EINTR)
+                continue;
+            throw std::system_error(errno, std::system_category(), "write");
+        }
+        done += r;
+    }
+    return done;
+}
+
+int main(int argc, char* argv[]) {
+    // map a file given on the command line, or this program's source
+    const char* path = argc >= 2 ? argv[1] : "mmap-buffer.cpp";
+
+    MappedBuffer file(path);
+    std::cout << "mapped " << path << ": " << file.size() << " bytes"
+              << std::endl;
+
+    // a region at an unaligned offset
+    MappedBuffer region(path, 3, 40);
+    std::cout << "region [3,43): " << region.to_string() << std::endl;
+
+    // move semantics mirror those of the heap Buffer
+    MappedBuffer moved = std::move(file);
+    std::cout << "moved: " << moved.size() << " bytes, old: "
+              << file.size() << " bytes" << std::endl;
+
+    // send the whole file without reading it into userspace memory
+    int null = open("/dev/null", O_WRONLY | O_CLOEXEC);
+    if (null >= 0) {
+        std::cout << "sent " << send(null, moved) << " bytes" << std::endl;
+        close(null);
+    }
+
+    return 0;
+}
@@ -10,12 +10,99 @@
 
 #include <tlx/delegate.hpp>
 
+//! compile with -DBUFFER_STATS=1 to count Buffer operations. when disabled,
+//! the counting branches are removed as dead code.
+#ifndef BUFFER_STATS
+#define BUFFER_STATS 0
+#endif
+
+static constexpr bool kBufferStats = BUFFER_STATS;
+
+//! Per-thread counters of Buffer operations. Counters are thread-local such
+//! that counting needs no atomics; live_bytes of one thread may become
+//! negative if it frees Buffers allocated by another thread.
+struct BufferStats {
+    //! number of heap allocations
+    size_t allocs = 0;
+    //! number of heap deallocations
+    size_t frees = 0;
+    //! number of move constructions
+    size_t move_constructs = 0;
+    //! number of move assignments
+    size_t move_assigns = 0;
+    //! total bytes allocated
+    size_t bytes_allocated = 0;
+    //! bytes currently allocated and not yet freed
+    int64_t live_bytes = 0;
+
+    //! counters of the calling thread
+    static BufferStats& local() {
+        static thread_local BufferStats stats;
+        return stats;
+    }
+
+    //! copy of the counters of the calling thread
+    static BufferStats snapshot() { return local(); }
+
+    //! difference between two snapshots
+    BufferStats operator - (const BufferStats& b) const {
+        BufferStats d;
+        d.allocs = allocs - b.allocs;
+        d.frees = frees - b.frees;
+        d.move_constructs = move_constructs - b.move_constructs;
+        d.move_assigns = move_assigns - b.move_assigns;
+        d.bytes_allocated = bytes_allocated - b.bytes_allocated;
+        d.live_bytes = live_bytes - b.live_bytes;
+        return d;
+    }
+};
+
+//! report counters
+std::ostream& operator << (std::ostream& os, const BufferStats& s) {
+    return os << "allocs=" << s.allocs << " frees=" << s.frees
+              << " move_constructs=" << s.move_constructs
+              << " move_assigns=" << s.move_assigns
+              << " bytes_allocated=" << s.bytes_allocated
+              << " live_bytes=" << s.live_bytes;
+}
+
+//! A non-owning view of a contiguous array: a minimal version of C++20's
+//! std::span, and with Type = const char a replacement for C++17's
+//! std::string_view.
+template <typename Type>
+class Span {
+public:
+    Span(Type* data, size_t size) : data_(data), size_(size) {}
+
+    Type* data() const { return data_; }
+    size_t size() const { return size_; }
+
+    Type* begin() const { return data_; }
+    Type* end() const { return data_ + size_; }
+
+    Type& operator [] (size_t i) const { return data_[i]; }
+
+private:
+    Type* data_;
+    size_t size_;
+};
+
+//! output a character view without copying it into a std::string first
+std::ostream& operator << (std::ostream& os, const Span<const char>& s) {
+    return os.write(s.data(), s.size());
+}
+
 //! A non-copyable move-only buffer which contains a "large" memory area
 class Buffer {
 public:
     //! allocate buffer containing n bytes
     explicit Buffer(size_t n)
-        : data_(reinterpret_cast<char*>(operator new(n))), size_(n) {}
+        : data_(reinterpret_cast<char*>(operator new(n))), size_(n) {
+        if (kBufferStats) {
+            BufferStats& s = BufferStats::local();
+            ++s.allocs, s.bytes_allocated += n, s.live_bytes += n;
+        }
+    }
 
     //! allocate buffer containing string str
     explicit Buffer(const char* str) : Buffer(strlen(str)) {
@@ -31,6 +118,8 @@ public:
     Buffer(Buffer&& other) noexcept : data_(other.data_), size_(other.size_) {
         other.data_ = nullptr;
         other.size_ = 0;
+        if (kBufferStats)
+            ++BufferStats::local().move_constructs;
     }
 
     //! move-assignment of other buffer into this one
@@ -38,6 +127,10 @@ public:
         if (this == &other)
             return *this;
 
+        if (kBufferStats) {
+            ++BufferStats::local().move_assigns;
+            count_free();
+        }
         operator delete(data_);
         data_ = other.data_;
         size_ = other.size_;
@@ -48,11 +141,30 @@ public:
     }
 
     //! delete buffer
-    ~Buffer() { operator delete(data_); }
+    ~Buffer() {
+        if (kBufferStats)
+            count_free();
+        operator delete(data_);
+    }
 
-    //! return as string
+    //! return as string: allocates and copies the whole content!
     std::string to_string() const { return std::string(data_, size_); }
 
+    //! pointer to the buffer's memory
+    const char* data() const { return data_; }
+
+    //! size of the buffer
+    size_t size() const { return size_; }
+
+    //! return non-owning string_view-like view of the content
+    Span<const char> view() const { return Span<const char>(data_, size_); }
+
+    //! return non-owning view of the content as bytes
+    Span<const uint8_t> bytes() const {
+        return Span<const uint8_t>(
+            reinterpret_cast<const uint8_t*>(data_), size_);
+    }
+
     //! l-value this
     void test() &
     { std::cout << "test: 'this' is a l-value" << std::endl; }
@@ -62,6 +174,14 @@ public:
     { std::cout << "test: 'this' is a r-value" << std::endl; }
 
 private:
+    //! count deallocation of data_, if any
+    void count_free() const {
+        if (data_ != nullptr) {
+            BufferStats& s = BufferStats::local();
+            ++s.frees, s.live_bytes -= size_;
+        }
+    }
+
     //! the buffer
     char* data_;
     //! buffer size
@@ -71,38 +191,38 @@ private:
 //! a "real" send function called by the "facade" send functions below. this is
 //! the const lvalue reference version, which internally has to copy the buffer
 void real_send(const Buffer& b) {
-    std::cout << "real_send (l-value ref): " << b.to_string() << std::endl;
+    std::cout << "real_send (l-value ref): " << b.view() << std::endl;
 }
 
 //! a "real" send function called by the "facade" send functions below. this is
 //! the (mutable) rvalue reference version, which can acquire the buffer's
 //! content without copying using a move operation.
 void real_send(Buffer&& b) {
-    std::cout << "real_send (r-value ref): " << b.to_string() << std::endl;
+    std::cout << "real_send (r-value ref): " << b.view() << std::endl;
 }
 
 //! function called by value
 void send1(Buffer b) {
     /* send ... */
-    std::cout << b.to_string() << std::endl;
+    std::cout << b.view() << std::endl;
 }
 
 //! function called by mutable l-value reference
 void send2(Buffer& b) {
     /* send ... */
-    std::cout << b.to_string() << std::endl;
+    std::cout << b.view() << std::endl;
 }
 
 //! function called by const l-value reference
 void send3(const Buffer& b) {
     /* send ... */
-    std::cout << b.to_string() << std::endl;
+    std::cout << b.view() << std::endl;
 }
 
 //! function called by r-value reference
 void send4(Buffer&& b) {
     /* send ... */
-    std::cout << b.to_string() << std::endl;
+    std::cout << b.view() << std::endl;
 }
 
 //! function making a Buffer -- the return value is automatically an rvalue.
@@ -128,7 +248,7 @@ public:
     Functor(Buffer&& b1) : b1(std::move(b1)) { }
 
     void operator () () const {
-        std::cout << b1.to_string() << std::endl;
+        std::cout << b1.view() << std::endl;
     }
 
 private:
@@ -156,6 +276,19 @@ int main() {
         send4(Buffer("temporary r-value"));     // ok: pass rvalue by reference
     }
 
+    // verify which send paths move and which allocate: compile with
+    // -DBUFFER_STATS=1 to see the counters.
+    if (kBufferStats) {
+        Buffer b1("buffer1"), b4("buffer4");
+
+        BufferStats before = BufferStats::snapshot();
+        send1(std::move(b1));      // one move construction, no allocation
+        send4(std::move(b4));      // no move at all, only a reference
+        send1(make_buffer());      // one allocation, copy elision
+        std::cout << "send stats: " << BufferStats::snapshot() - before
+                  << std::endl;
+    }
+
     // distinguish if this is l-value or r-value
     {
         Buffer lvalue("l-value this");
@@ -198,7 +331,7 @@ int main() {
 
         // cannot move bl into lambda's closure
         std::function<void()> print_std_function = [&bl]() {
-            std::cout << bl.to_string() << std::endl;
+            std::cout << bl.view() << std::endl;
         };
 
         print_std_function();
@@ -210,11 +343,14 @@ int main() {
         Buffer bl("std::function buffer");
 
         tlx::delegate<void()> print_std_function = [bl = std::move(bl)]() {
-            std::cout << bl.to_string() << std::endl;
+            std::cout << bl.view() << std::endl;
         };
 
         print_std_function();
     }
 
+    if (kBufferStats)
+        std::cout << "total stats: " << BufferStats::local() << std::endl;
+
     return 0;
 }
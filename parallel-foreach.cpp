@@ -0,0 +1,330 @@
+// parallel call_foreach: apply a generic lambda to each parameter or tuple
+// component concurrently on a thread pool, and join
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+//! A simple thread pool with one shared task queue. See work-stealing-pool.cpp
+//! for a more scalable one.
+class ThreadPool {
+public:
+    //! start the given number of worker threads
+    explicit ThreadPool(
+        size_t num_threads = std::max(1u, std::thread::hardware_concurrency()))
+    {
+        for (size_t i = 0; i < num_threads; ++i)
+            threads_.emplace_back([this]() { worker(); });
+    }
+
+    //! non-copyable: delete copy-constructor
+    ThreadPool(const ThreadPool&) = delete;
+    //! non-copyable: delete assignment operator
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    //! finish queued tasks, then stop the workers
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            terminate_ = true;
+        }
+        cv_.notify_all();
+        for (std::thread& t : threads_)
+            t.join();
+    }
+
+    void submit(std::function<void()> task) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            tasks_.emplace_back(std::move(task));
+        }
+        cv_.notify_one();
+    }
+
+    //! run one queued task on the calling thread, if there is one. Threads
+    //! which wait for a join call this, hence they help instead of blocking,
+    //! which also makes nested parallel calls from workers deadlock-free.
+    bool try_run_one() {
+        std::function<void()> task;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (tasks_.empty())
+                return false;
+            task = std::move(tasks_.front());
+            tasks_.pop_front();
+        }
+        task();
+        return true;
+    }
+
+    //! number of worker threads
+    size_t size() const { return threads_.size(); }
+
+private:
+    void worker() {
+        for ( ; ; ) {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                cv_.wait(lock,
+                         [this]() { return terminate_ || !tasks_.empty(); });
+                if (tasks_.empty())
+                    return;
+                task = std::move(tasks_.front());
+                tasks_.pop_front();
+            }
+            task();
+        }
+    }
+
+    std::vector<std::thread> threads_;
+    std::deque<std::function<void()> > tasks_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    bool terminate_ = false;
+};
+
+//! Join point of one parallel call: counts finished tasks and keeps the
+//! first exception, which is rethrown in the joining thread.
+class Join {
+public:
+    explicit Join(size_t count) : count_(count) {}
+
+    //! run a task and count it as finished
+    template <typename Functor>
+    void run(Functor&& f) {
+        std::exception_ptr error;
+        try {
+            f();
+        }
+        catch (...) {
+            error = std::current_exception();
+        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (error && !error_)
+            error_ = error;
+        if (--count_ == 0)
+            cv_.notify_all();
+    }
+
+    //! execute queued tasks of the pool until none are left, then block until
+    //! all tasks of this join are done.
+    void wait(ThreadPool& pool) {
+        while (!done() && pool.try_run_one()) { }
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait(lock, [this]() { return count_ == 0; });
+        if (error_)
+            std::rethrow_exception(error_);
+    }
+
+private:
+    bool done() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return count_ == 0;
+    }
+
+    size_t count_;
+    std::exception_ptr error_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+};
+
+/******************************************************************************/
+// the parallel variants of tlx::call_foreach, call_foreach_with_index and
+// call_foreach_tuple_with_index, as used in VTSimple. Each parameter becomes
+// one task, except the first, which the calling thread processes itself. The
+// functions return when all calls have finished. Parameters are passed by
+// reference, hence the calls must be independent of each other.
+
+template <typename Functor, typename... Types, size_t... Is>
+void parallel_call_foreach_impl(
+    ThreadPool& pool, Functor& f, std::index_sequence<Is...>,
+    Types&... values) {
+    Join join(sizeof...(Types));
+    using VarForeachExpander = int[];
+    // submit all but the first parameter to the pool
+    (void)VarForeachExpander{
+        0, (Is == 0 ? 0 : (pool.submit([&f, &values, &join]() {
+                               join.run([&f, &values]() { f(values); });
+                           }), 0))...
+    };
+    // the calling thread processes the first parameter itself
+    (void)VarForeachExpander{
+        0, (Is == 0 ? (join.run([&f, &values]() { f(values); }), 0) : 0)...
+    };
+    join.wait(pool);
+}
+
+//! call f(value) for each value in parallel
+template <typename Functor, typename... Types>
+void parallel_call_foreach(ThreadPool& pool, Functor&& f, Types&&... values) {
+    parallel_call_foreach_impl(
+        pool, f, std::index_sequence_for<Types...>(), values...);
+}
+
+//! call f(index, value) for each value in parallel, with index a
+//! std::integral_constant
+template <typename Functor, typename... Types, size_t... Is>
+void parallel_call_foreach_with_index_impl(
+    ThreadPool& pool, Functor& f, std::index_sequence<Is...>,
+    Types&&... values) {
+    parallel_call_foreach(
+        pool,
+        [&f](auto&& pair) {
+            f(pair.first, pair.second);
+        },
+        std::pair<std::integral_constant<size_t, Is>, Types&&>(
+            std::integral_constant<size_t, Is>(),
+            std::forward<Types>(values))...);
+}
+
+template <typename Functor, typename... Types>
+void parallel_call_foreach_with_index(
+    ThreadPool& pool, Functor&& f, Types&&... values) {
+    parallel_call_foreach_with_index_impl(
+        pool, f, std::index_sequence_for<Types...>(),
+        std::forward<Types>(values)...);
+}
+
+template <typename Functor, typename Tuple, size_t... Is>
+void parallel_call_foreach_tuple_with_index_impl(
+    ThreadPool& pool, Functor& f, Tuple& t, std::index_sequence<Is...>) {
+    parallel_call_foreach_with_index(pool, f, std::get<Is>(t)...);
+}
+
+//! call f(index, component) for each component of tuple t in parallel
+template <typename Functor, typename Tuple>
+void parallel_call_foreach_tuple_with_index(
+    ThreadPool& pool, Functor&& f, Tuple& t) {
+    parallel_call_foreach_tuple_with_index_impl(
+        pool, f, t,
+        std::make_index_sequence<
+            std::tuple_size<typename std::decay<Tuple>::type>::value>());
+}
+
+//! sequential version for comparison, like tlx::call_foreach_tuple_with_index
+template <typename Functor, typename Tuple, size_t... Is>
+void call_foreach_tuple_with_index_impl(
+    Functor& f, Tuple& t, std::index_sequence<Is...>) {
+    using VarForeachExpander = int[];
+    (void)VarForeachExpander{
+        0, (f(std::integral_constant<size_t, Is>(), std::get<Is>(t)), 0)...
+    };
+}
+
+template <typename Functor, typename Tuple>
+void call_foreach_tuple_with_index(Functor&& f, Tuple& t) {
+    call_foreach_tuple_with_index_impl(
+        f, t,
+        std::make_index_sequence<
+            std::tuple_size<typename std::decay<Tuple>::type>::value>());
+}
+
+/******************************************************************************/
+
+//! VTSimple from variadic-templates.cpp with a parallel run()
+template <typename... Types>
+class VTSimple {
+public:
+    VTSimple(const Types&... values) : tuple_(values...) {}
+
+    //! process each component concurrently on the pool
+    template <typename Functor>
+    void run(ThreadPool& pool, Functor&& f) {
+        parallel_call_foreach_tuple_with_index(pool, f, tuple_);
+    }
+
+    std::tuple<Types...> tuple_;
+};
+
+//! fill a vector with pseudo-random values
+template <typename Type>
+std::vector<Type> random_column(size_t n, uint32_t seed) {
+    std::vector<Type> v(n);
+    uint32_t x = seed;
+    for (Type& item : v) {
+        x ^= x << 13, x ^= x >> 17, x ^= x << 5;
+        item = static_cast<Type>(x % 1000000);
+    }
+    return v;
+}
+
+int main() {
+    ThreadPool pool;
+
+    // print parameters concurrently; the order varies
+    std::mutex cout_mutex;
+    parallel_call_foreach(
+        pool,
+        [&cout_mutex](const auto& v) {
+            std::lock_guard<std::mutex> lock(cout_mutex);
+            std::cout << v << std::endl;
+        },
+        5, 5.0, std::string("hello"));
+
+    VTSimple<int, double, std::string> vt(42, 1.5, "world");
+    vt.run(pool, [&cout_mutex](auto index, auto& v) {
+        std::lock_guard<std::mutex> lock(cout_mutex);
+        std::cout << index << ": " << v << std::endl;
+    });
+
+    // exceptions are propagated to the caller after the join
+    try {
+        parallel_call_foreach(
+            pool,
+            [](int v) {
+                if (v == 2)
+                    throw std::runtime_error("failed on 2");
+            },
+            1, 2, 3);
+    }
+    catch (std::exception& e) {
+        std::cout << "caught: " << e.what() << std::endl;
+    }
+
+    // a multi-column pipeline step: sort each column of a tuple of vectors
+    const size_t n = 2 * 1024 * 1024;
+    auto make_columns = [n]() {
+        return std::make_tuple(
+            random_column<int32_t>(n, 1), random_column<double>(n, 2),
+            random_column<float>(n, 3), random_column<int64_t>(n, 4));
+    };
+    auto sort_column = [](auto /* index */, auto& column) {
+        std::sort(column.begin(), column.end());
+    };
+
+    auto columns1 = make_columns();
+    auto start = std::chrono::steady_clock::now();
+    call_foreach_tuple_with_index(sort_column, columns1);
+    auto middle = std::chrono::steady_clock::now();
+
+    auto columns2 = make_columns();
+    auto middle2 = std::chrono::steady_clock::now();
+    parallel_call_foreach_tuple_with_index(pool, sort_column, columns2);
+    auto stop = std::chrono::steady_clock::now();
+
+    std::cout << "sort 4 columns on " << pool.size() << " threads: sequential="
+              << std::chrono::duration<double, std::milli>(
+                  middle - start).count()
+              << "ms parallel="
+              << std::chrono::duration<double, std::milli>(
+                  stop - middle2).count()
+              << "ms (" << (columns1 == columns2 ? "equal" : "DIFFER") << ")"
+              << std::endl;
+
+    return 0;
+}
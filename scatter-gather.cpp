@@ -0,0 +1,213 @@
+// scatter-gather send of several Buffers with one writev() call
+
+#include <algorithm>
+#include <cassert>
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include <limits.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+//! A non-copyable move-only buffer which contains a "large" memory area
+class Buffer {
+public:
+    //! allocate buffer containing n bytes
+    explicit Buffer(size_t n)
+        : data_(reinterpret_cast<char*>(operator new(n))), size_(n) {}
+
+    //! allocate buffer containing string str
+    explicit Buffer(const char* str) : Buffer(strlen(str)) {
+        std::copy(str, str + size_, data_);
+    }
+
+    //! non-copyable: delete copy-constructor
+    Buffer(const Buffer&) = delete;
+    //! non-copyable: delete assignment operator
+    Buffer& operator=(const Buffer&) = delete;
+
+    //! move-construct other buffer into this one
+    Buffer(Buffer&& other) noexcept : data_(other.data_), size_(other.size_) {
+        other.data_ = nullptr;
+        other.size_ = 0;
+    }
+
+    //! move-assignment of other buffer into this one
+    Buffer& operator=(Buffer&& other) noexcept {
+        if (this == &other)
+            return *this;
+
+        operator delete(data_);
+        data_ = other.data_;
+        size_ = other.size_;
+        other.data_ = nullptr;
+        other.size_ = 0;
+
+        return *this;
+    }
+
+    //! delete buffer
+    ~Buffer() { operator delete(data_); }
+
+    //! pointer to the buffer's memory
+    const char* data() const { return data_; }
+
+    //! size of the buffer
+    size_t size() const { return size_; }
+
+private:
+    //! the buffer
+    char* data_;
+    //! buffer size
+    size_t size_;
+};
+
+//! A non-owning slice of some contiguous memory, e.g. of a Buffer. Slices are
+//! only valid while the Buffer lives, which is sufficient for synchronous
+//! sending; see shared-buffer.cpp for owning reference-counted slices, which
+//! work the same way with the functions below.
+class Slice {
+public:
+    Slice(const char* data, size_t size) : data_(data), size_(size) {}
+
+    //! slice covering a whole Buffer
+    Slice(const Buffer& b) : Slice(b.data(), b.size()) {}
+
+    //! sub-slice of bytes [offset, offset + length)
+    Slice slice(size_t offset, size_t length) const {
+        assert(offset + length <= size_);
+        return Slice(data_ + offset, length);
+    }
+
+    const char* data() const { return data_; }
+    size_t size() const { return size_; }
+
+private:
+    const char* data_;
+    size_t size_;
+};
+
+/******************************************************************************/
+
+//! writev-style sink interface: consumes a list of memory areas at once
+class GatherSink {
+public:
+    virtual ~GatherSink() = default;
+
+    //! write all bytes of the iovec list, returns number of bytes written
+    virtual size_t writev(const struct iovec* iov, size_t count) = 0;
+};
+
+//! sink writing to a file descriptor using ::writev(), including handling of
+//! partial writes and IOV_MAX limits.
+class FdSink final : public GatherSink {
+public:
+    explicit FdSink(int fd) : fd_(fd) {}
+
+    size_t writev(const struct iovec* iov, size_t count) final {
+        // ::writev() may advance only part of the list, hence we work on a
+        // copy which can be adjusted.
+        std::vector<struct iovec> rest(iov, iov + count);
+        struct iovec* first = rest.data();
+        struct iovec* last = first + count;
+        size_t total = 0;
+
+        while (first != last) {
+            int n = static_cast<int>(std::min<size_t>(last - first, IOV_MAX));
+            ssize_t r = ::writev(fd_, first, n);
+            if (r < 0) {
+                if (errno == EINTR)
+                    continue;
+                throw std::system_error(errno, std::system_category(),
+                                        "writev");
+            }
+            total += r;
+
+            // skip fully written iovecs, adjust the partially written one
+            size_t done = r;
+            while (first != last && done >= first->iov_len)
+                done -= first->iov_len, ++first;
+            if (done != 0) {
+                first->iov_base = static_cast<char*>(first->iov_base) + done;
+                first->iov_len -= done;
+            }
+        }
+        return total;
+    }
+
+private:
+    int fd_;
+};
+
+//! convert anything with data() and size() into an iovec
+template <typename Part>
+struct iovec make_iovec(const Part& part) {
+    struct iovec v;
+    v.iov_base = const_cast<char*>(part.data());
+    v.iov_len = part.size();
+    return v;
+}
+
+//! send a fixed number of parts, e.g. header + body + trailer, in one call.
+//! the iovec array lives on the stack.
+template <typename... Parts>
+size_t send(GatherSink& sink, const Parts&... parts) {
+    struct iovec iov[sizeof...(Parts)] = { make_iovec(parts)... };
+    return sink.writev(iov, sizeof...(Parts));
+}
+
+//! send no parts: a zero-length iovec array would be ill-formed.
+inline size_t send(GatherSink& /* sink */) {
+    return 0;
+}
+
+//! send a sequence of parts, e.g. a std::vector<Buffer>, in one call.
+template <typename Iterator>
+size_t send_range(GatherSink& sink, Iterator begin, Iterator end) {
+    std::vector<struct iovec> iov;
+    for (Iterator it = begin; it != end; ++it)
+        iov.emplace_back(make_iovec(*it));
+    return sink.writev(iov.data(), iov.size());
+}
+
+int main() {
+    // mixing std::cout and direct writes to fd 1 requires flushing
+    std::cout << "scatter-gather send:" << std::endl;
+
+    FdSink out(STDOUT_FILENO);
+
+    // compose header + body + trailer without concatenation copies
+    {
+        Buffer header("HEADER|"), body("message body"), trailer("|TRAILER\n");
+        size_t n = send(out, header, body, trailer);
+        std::cout << "sent " << n << " bytes in one writev()" << std::endl;
+    }
+
+    // send slices: re-frame a received message without copying it
+    {
+        Buffer frame("xxxxpayload-of-frameyyyy");
+        Slice payload = Slice(frame).slice(4, 16);
+        Buffer newline("\n");
+        send(out, payload, newline);
+    }
+
+    // send a whole sequence of buffers
+    {
+        std::vector<Buffer> parts;
+        for (size_t i = 0; i < 5; ++i)
+            parts.emplace_back(("part" + std::to_string(i) + " ").c_str());
+        parts.emplace_back("\n");
+
+        size_t n = send_range(out, parts.begin(), parts.end());
+        std::cout << "sent " << n << " bytes from " << parts.size()
+                  << " buffers" << std::endl;
+    }
+
+    return 0;
+}
@@ -0,0 +1,248 @@
+// reference-counted immutable SharedBuffer for zero-copy fan-out and slicing
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+//! A non-copyable move-only buffer which contains a "large" memory area
+class Buffer {
+public:
+    //! allocate buffer containing n bytes
+    explicit Buffer(size_t n)
+        : data_(reinterpret_cast<char*>(operator new(n))), size_(n) {}
+
+    //! allocate buffer containing string str
+    explicit Buffer(const char* str) : Buffer(strlen(str)) {
+        std::copy(str, str + size_, data_);
+    }
+
+    //! non-copyable: delete copy-constructor
+    Buffer(const Buffer&) = delete;
+    //! non-copyable: delete assignment operator
+    Buffer& operator=(const Buffer&) = delete;
+
+    //! move-construct other buffer into this one
+    Buffer(Buffer&& other) noexcept : data_(other.data_), size_(other.size_) {
+        other.data_ = nullptr;
+        other.size_ = 0;
+    }
+
+    //! move-assignment of other buffer into this one
+    Buffer& operator=(Buffer&& other) noexcept {
+        if (this == &other)
+            return *this;
+
+        operator delete(data_);
+        data_ = other.data_;
+        size_ = other.size_;
+        other.data_ = nullptr;
+        other.size_ = 0;
+
+        return *this;
+    }
+
+    //! delete buffer
+    ~Buffer() { operator delete(data_); }
+
+    //! return as string
+    std::string to_string() const { return std::string(data_, size_); }
+
+    //! pointer to the buffer's memory
+    char* data() { return data_; }
+
+    //! size of the buffer
+    size_t size() const { return size_; }
+
+    //! give up ownership of the memory area, which must then be freed with
+    //! operator delete by the caller. an r-value method: only callable on
+    //! buffers that are being moved from.
+    char* release() && {
+        char* data = data_;
+        data_ = nullptr;
+        size_ = 0;
+        return data;
+    }
+
+private:
+    //! the buffer
+    char* data_;
+    //! buffer size
+    size_t size_;
+};
+
+//! An immutable, reference-counted view of (a slice of) a Buffer's memory.
+//! Copying a SharedBuffer only increments an atomic counter, and slicing
+//! creates another handle onto the same memory, hence sending one payload to
+//! many receivers or splitting off a header never copies bytes. The memory is
+//! freed when the last handle is destroyed.
+class SharedBuffer {
+public:
+    //! empty handle
+    SharedBuffer() = default;
+
+    //! take ownership of a Buffer's memory without copying it
+    explicit SharedBuffer(Buffer&& b) : block_(new Block), size_(b.size()) {
+        block_->data = std::move(b).release();
+        data_ = block_->data;
+    }
+
+    //! copy-construct: share the other's memory
+    SharedBuffer(const SharedBuffer& other) noexcept
+        : block_(other.block_), data_(other.data_), size_(other.size_) {
+        acquire();
+    }
+
+    //! move-construct: take over the other's reference
+    SharedBuffer(SharedBuffer&& other) noexcept
+        : block_(other.block_), data_(other.data_), size_(other.size_) {
+        other.block_ = nullptr;
+        other.data_ = nullptr;
+        other.size_ = 0;
+    }
+
+    //! copy-assignment via copy-and-swap
+    SharedBuffer& operator=(const SharedBuffer& other) noexcept {
+        SharedBuffer(other).swap(*this);
+        return *this;
+    }
+
+    //! move-assignment via move-and-swap
+    SharedBuffer& operator=(SharedBuffer&& other) noexcept {
+        SharedBuffer(std::move(other)).swap(*this);
+        return *this;
+    }
+
+    //! drop one reference
+    ~SharedBuffer() { release(); }
+
+    void swap(SharedBuffer& other) noexcept {
+        std::swap(block_, other.block_);
+        std::swap(data_, other.data_);
+        std::swap(size_, other.size_);
+    }
+
+    //! return a handle onto the bytes [offset, offset + length) of this one
+    SharedBuffer slice(size_t offset, size_t length) const {
+        assert(offset + length <= size_);
+        SharedBuffer s(*this);
+        s.data_ += offset;
+        s.size_ = length;
+        return s;
+    }
+
+    //! return a handle onto the bytes from offset to the end
+    SharedBuffer slice(size_t offset) const {
+        assert(offset <= size_);
+        return slice(offset, size_ - offset);
+    }
+
+    //! pointer to the (immutable) bytes
+    const char* data() const { return data_; }
+
+    //! number of bytes in this slice
+    size_t size() const { return size_; }
+
+    //! number of handles sharing the underlying memory
+    size_t use_count() const {
+        return block_ ? block_->refs.load(std::memory_order_relaxed) : 0;
+    }
+
+    //! return as string (copies!)
+    std::string to_string() const { return std::string(data_, size_); }
+
+private:
+    //! shared control block holding the memory and its reference count
+    struct Block {
+        std::atomic<size_t> refs { 1 };
+        char* data;
+    };
+
+    void acquire() noexcept {
+        if (block_)
+            block_->refs.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void release() noexcept {
+        // acq_rel: all uses of the memory happen before it is deleted
+        if (block_ &&
+            block_->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            operator delete(block_->data);
+            delete block_;
+        }
+    }
+
+    //! control block, nullptr for an empty handle
+    Block* block_ = nullptr;
+    //! first byte of this slice
+    const char* data_ = nullptr;
+    //! length of this slice
+    size_t size_ = 0;
+};
+
+//! a subscriber which keeps messages until it "sends" them
+class Subscriber {
+public:
+    explicit Subscriber(std::string name) : name_(std::move(name)) {}
+
+    //! receive by value: copies only the handle, never the payload
+    void receive(SharedBuffer msg) { queue_.emplace_back(std::move(msg)); }
+
+    void flush() {
+        for (const SharedBuffer& msg : queue_) {
+            std::cout << name_ << ": ";
+            std::cout.write(msg.data(), msg.size());
+            std::cout << std::endl;
+        }
+        queue_.clear();
+    }
+
+private:
+    std::string name_;
+    std::vector<SharedBuffer> queue_;
+};
+
+int main() {
+    // fan-out: one payload to many subscribers
+    {
+        std::vector<Subscriber> subscribers;
+        for (size_t i = 0; i < 3; ++i)
+            subscribers.emplace_back("subscriber" + std::to_string(i));
+
+        Buffer b("fan-out payload");
+        const char* raw = b.data();
+
+        SharedBuffer msg(std::move(b));
+        for (Subscriber& s : subscribers)
+            s.receive(msg);
+
+        std::cout << "use_count=" << msg.use_count()
+                  << " same memory=" << (msg.data() == raw) << std::endl;
+
+        for (Subscriber& s : subscribers)
+            s.flush();
+
+        std::cout << "use_count=" << msg.use_count() << std::endl;
+    }
+
+    // header/payload splitting: both parts share the received frame
+    {
+        SharedBuffer frame(Buffer("HDR:0007payload"));
+
+        SharedBuffer header = frame.slice(0, 8);
+        SharedBuffer payload = frame.slice(8);
+
+        // the frame itself can go away, the slices keep the memory alive
+        frame = SharedBuffer();
+
+        std::cout << "header=" << header.to_string()
+                  << " payload=" << payload.to_string()
+                  << " use_count=" << payload.use_count() << std::endl;
+    }
+
+    return 0;
+}
@@ -0,0 +1,222 @@
+// move-only Buffer with small-buffer optimization (SBO), like std::string's SSO
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+//! The original move-only buffer, which always allocates on the heap.
+class HeapBuffer {
+public:
+    //! allocate buffer containing n bytes
+    explicit HeapBuffer(size_t n)
+        : data_(reinterpret_cast<char*>(operator new(n))), size_(n) {}
+
+    //! allocate buffer containing string str
+    explicit HeapBuffer(const char* str) : HeapBuffer(strlen(str)) {
+        std::copy(str, str + size_, data_);
+    }
+
+    //! non-copyable: delete copy-constructor
+    HeapBuffer(const HeapBuffer&) = delete;
+    //! non-copyable: delete assignment operator
+    HeapBuffer& operator=(const HeapBuffer&) = delete;
+
+    //! move-construct other buffer into this one
+    HeapBuffer(HeapBuffer&& other) noexcept
+        : data_(other.data_), size_(other.size_) {
+        other.data_ = nullptr;
+        other.size_ = 0;
+    }
+
+    //! move-assignment of other buffer into this one
+    HeapBuffer& operator=(HeapBuffer&& other) noexcept {
+        if (this == &other)
+            return *this;
+
+        operator delete(data_);
+        data_ = other.data_;
+        size_ = other.size_;
+        other.data_ = nullptr;
+        other.size_ = 0;
+
+        return *this;
+    }
+
+    //! delete buffer
+    ~HeapBuffer() { operator delete(data_); }
+
+    //! return as string
+    std::string to_string() const { return std::string(data_, size_); }
+
+    //! pointer to the buffer's memory
+    char* data() { return data_; }
+
+    //! size of the buffer
+    size_t size() const { return size_; }
+
+private:
+    //! the buffer
+    char* data_;
+    //! buffer size
+    size_t size_;
+};
+
+//! A non-copyable move-only buffer which stores up to kInlineSize bytes inside
+//! the object itself and only allocates larger ones on the heap. Which mode is
+//! used is determined by size_ alone, so no extra flag is needed.
+class Buffer {
+public:
+    //! number of bytes stored inline, without heap allocation
+    static constexpr size_t kInlineSize = 64;
+
+    //! allocate buffer containing n bytes
+    explicit Buffer(size_t n) : size_(n) {
+        if (!is_inline())
+            heap_ = reinterpret_cast<char*>(operator new(n));
+    }
+
+    //! allocate buffer containing string str
+    explicit Buffer(const char* str) : Buffer(strlen(str)) {
+        std::copy(str, str + size_, data());
+    }
+
+    //! non-copyable: delete copy-constructor
+    Buffer(const Buffer&) = delete;
+    //! non-copyable: delete assignment operator
+    Buffer& operator=(const Buffer&) = delete;
+
+    //! move-construct other buffer into this one: inline bytes have to be
+    //! copied, heap memory is stolen as before.
+    Buffer(Buffer&& other) noexcept : size_(other.size_) {
+        steal(other);
+    }
+
+    //! move-assignment of other buffer into this one
+    Buffer& operator=(Buffer&& other) noexcept {
+        if (this == &other)
+            return *this;
+
+        release();
+        size_ = other.size_;
+        steal(other);
+
+        return *this;
+    }
+
+    //! delete buffer
+    ~Buffer() { release(); }
+
+    //! return as string
+    std::string to_string() const { return std::string(data(), size_); }
+
+    //! pointer to the buffer's memory
+    char* data() { return is_inline() ? inline_ : heap_; }
+
+    //! pointer to the buffer's memory
+    const char* data() const { return is_inline() ? inline_ : heap_; }
+
+    //! size of the buffer
+    size_t size() const { return size_; }
+
+    //! whether the bytes are stored inside the object
+    bool is_inline() const { return size_ <= kInlineSize; }
+
+private:
+    //! take over other's content (size_ is already set) and empty other
+    void steal(Buffer& other) noexcept {
+        if (is_inline())
+            std::memcpy(inline_, other.inline_, size_);
+        else
+            heap_ = other.heap_;
+        other.size_ = 0;
+    }
+
+    //! free heap memory, if any
+    void release() noexcept {
+        if (!is_inline())
+            operator delete(heap_);
+    }
+
+    //! buffer size, also selects the storage mode
+    size_t size_;
+
+    union {
+        //! heap memory for large buffers
+        char* heap_;
+        //! inline storage for small buffers
+        char inline_[kInlineSize];
+    };
+};
+
+/******************************************************************************/
+
+//! create, fill, move through a queue and destroy many buffers of size n.
+//! returns nanoseconds per buffer.
+template <typename BufferType>
+double benchmark(size_t n, size_t rounds) {
+    std::vector<BufferType> queue;
+    queue.reserve(256);
+    size_t checksum = 0;
+
+    auto start = std::chrono::steady_clock::now();
+
+    for (size_t i = 0; i < rounds; ++i) {
+        BufferType b(n);
+        std::memset(b.data(), static_cast<int>(i), n);
+        queue.emplace_back(std::move(b));
+
+        if (queue.size() == 256) {
+            for (BufferType& q : queue)
+                checksum += static_cast<unsigned char>(q.data()[n - 1]);
+            queue.clear();
+        }
+    }
+
+    auto stop = std::chrono::steady_clock::now();
+
+    // use the checksum such that the work cannot be optimized away
+    if (checksum == 1)
+        std::cout << "checksum " << checksum << std::endl;
+
+    return std::chrono::duration<double, std::nano>(stop - start).count()
+           / rounds;
+}
+
+int main() {
+    // small buffers live inside the object, large ones on the heap
+    {
+        Buffer small("short payload");
+        Buffer large(1000);
+        std::cout << small.to_string() << " inline=" << small.is_inline()
+                  << std::endl;
+        std::cout << "1000 bytes inline=" << large.is_inline() << std::endl;
+
+        // moving copies the inline bytes, but steals the heap pointer
+        Buffer moved = std::move(small);
+        std::cout << moved.to_string() << " (moved), old size "
+                  << small.size() << std::endl;
+
+        moved = std::move(large);
+        std::cout << "assigned large: " << moved.size() << " bytes"
+                  << std::endl;
+    }
+
+    std::cout << "sizeof(HeapBuffer)=" << sizeof(HeapBuffer)
+              << " sizeof(Buffer)=" << sizeof(Buffer) << std::endl;
+
+    // compare heap-only and small-buffer optimized versions
+    std::cout << "size\theap ns\tsbo ns" << std::endl;
+    for (size_t n = 1; n <= 4096; n *= 2) {
+        const size_t rounds = 1000000;
+        std::cout << n << '\t' << benchmark<HeapBuffer>(n, rounds)
+                  << '\t' << benchmark<Buffer>(n, rounds) << std::endl;
+    }
+
+    return 0;
+}
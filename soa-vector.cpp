@@ -0,0 +1,310 @@
+// structure-of-arrays container generated from a variadic type list
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+//! a non-owning view of a contiguous array, as in move-only-buffer.cpp
+template <typename Type>
+class Span {
+public:
+    Span(Type* data, size_t size) : data_(data), size_(size) {}
+
+    Type* data() const { return data_; }
+    size_t size() const { return size_; }
+
+    Type* begin() const { return data_; }
+    Type* end() const { return data_ + size_; }
+
+    Type& operator [] (size_t i) const { return data_[i]; }
+
+private:
+    Type* data_;
+    size_t size_;
+};
+
+//! the recursive VTClass from variadic-templates.cpp: a std::vector of it is
+//! an array of structs.
+template <typename... Types>
+class VTClass;
+
+template <typename Type, typename... Types>
+class VTClass<Type, Types...> {
+public:
+    VTClass(const Type& value, const Types&... rest)
+        : value_(value), rest_(rest...) {}
+
+    Type value_;
+
+    VTClass<Types...> rest_;
+};
+
+template <>
+class VTClass<> {};
+
+/******************************************************************************/
+
+//! A container of rows with components Types..., stored as one contiguous
+//! std::vector per component (a structure of arrays). A scan over one column
+//! reads only that column's memory, and the compiler can vectorize the loop
+//! as if it were over a plain array. Rows are accessed through proxies, which
+//! are tuples of references into the columns. Note that a bool component
+//! would be a std::vector<bool>, which has no contiguous span.
+template <typename... Types>
+class SoAVector {
+public:
+    //! a row by value
+    using value_type = std::tuple<Types...>;
+    //! proxy to a row: a tuple of references into the columns
+    using reference = std::tuple<Types&...>;
+    using const_reference = std::tuple<const Types&...>;
+
+    //! type of column I
+    template <size_t I>
+    using column_type = typename std::tuple_element<I, value_type>::type;
+
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+
+    void reserve(size_t n) {
+        for_each_column([n](auto& column) { column.reserve(n); });
+    }
+
+    void clear() {
+        for_each_column([](auto& column) { column.clear(); });
+        size_ = 0;
+    }
+
+    //! append a row given as components
+    void push_back(const Types&... values) {
+        push_back(std::forward_as_tuple(values...),
+                  std::index_sequence_for<Types...>());
+    }
+
+    //! append a row given as a tuple
+    void push_back(const value_type& row) {
+        push_back(row, std::index_sequence_for<Types...>());
+    }
+
+    //! proxy for row i
+    reference operator [] (size_t i) {
+        return row(i, std::index_sequence_for<Types...>());
+    }
+
+    //! read-only proxy for row i
+    const_reference operator [] (size_t i) const {
+        return row(i, std::index_sequence_for<Types...>());
+    }
+
+    //! contiguous array of component I of all rows
+    template <size_t I>
+    Span<column_type<I> > column() {
+        return Span<column_type<I> >(std::get<I>(columns_).data(), size_);
+    }
+
+    //! read-only contiguous array of component I of all rows
+    template <size_t I>
+    Span<const column_type<I> > column() const {
+        return Span<const column_type<I> >(
+            std::get<I>(columns_).data(), size_);
+    }
+
+    //! iterator over rows, dereferencing to row proxies
+    class iterator {
+    public:
+        iterator(SoAVector* v, size_t i) : v_(v), i_(i) {}
+
+        reference operator * () const { return (*v_)[i_]; }
+        iterator& operator ++ () { ++i_; return *this; }
+        bool operator != (const iterator& o) const { return i_ != o.i_; }
+
+    private:
+        SoAVector* v_;
+        size_t i_;
+    };
+
+    //! iterator over rows, dereferencing to read-only row proxies
+    class const_iterator {
+    public:
+        const_iterator(const SoAVector* v, size_t i) : v_(v), i_(i) {}
+
+        const_reference operator * () const { return (*v_)[i_]; }
+        const_iterator& operator ++ () { ++i_; return *this; }
+        bool operator != (const const_iterator& o) const {
+            return i_ != o.i_;
+        }
+
+    private:
+        const SoAVector* v_;
+        size_t i_;
+    };
+
+    iterator begin() { return iterator(this, 0); }
+    iterator end() { return iterator(this, size_); }
+
+    const_iterator begin() const { return const_iterator(this, 0); }
+    const_iterator end() const { return const_iterator(this, size_); }
+
+private:
+    //! one vector per component
+    std::tuple<std::vector<Types>...> columns_;
+    //! number of rows, also for empty Types
+    size_t size_ = 0;
+
+    //! apply a generic lambda to each column
+    template <typename Functor>
+    void for_each_column(Functor f) {
+        for_each_column(f, std::index_sequence_for<Types...>());
+    }
+
+    template <typename Functor, size_t... Is>
+    void for_each_column(Functor& f, std::index_sequence<Is...>) {
+        using VarForeachExpander = int[];
+        (void)VarForeachExpander{ 0, (f(std::get<Is>(columns_)), 0)... };
+    }
+
+    //! append to each column. If one push_back throws, the columns which
+    //! already grew are shrunk back, such that all have size_ rows again.
+    template <typename Tuple, size_t... Is>
+    void push_back(const Tuple& row, std::index_sequence<Is...>) {
+        try {
+            using VarForeachExpander = int[];
+            (void)VarForeachExpander{
+                0, (std::get<Is>(columns_).push_back(std::get<Is>(row)), 0)...
+            };
+        }
+        catch (...) {
+            for_each_column([this](auto& column) {
+                if (column.size() > size_)
+                    column.pop_back();
+            });
+            throw;
+        }
+        ++size_;
+    }
+
+    template <size_t... Is>
+    reference row(size_t i, std::index_sequence<Is...>) {
+        return reference(std::get<Is>(columns_)[i]...);
+    }
+
+    template <size_t... Is>
+    const_reference row(size_t i, std::index_sequence<Is...>) const {
+        return const_reference(std::get<Is>(columns_)[i]...);
+    }
+};
+
+/******************************************************************************/
+
+//! component whose copy throws if flagged, to check push_back's rollback
+struct FailingCopy {
+    bool fail;
+
+    explicit FailingCopy(bool f) : fail(f) {}
+    FailingCopy(const FailingCopy& o) : fail(o.fail) {
+        if (fail)
+            throw std::runtime_error("copy failed");
+    }
+};
+
+int main() {
+    {
+        SoAVector<int, double, std::string> v;
+        v.push_back(1, 1.5, "one");
+        v.push_back(std::make_tuple(2, 2.5, std::string("two")));
+
+        // row proxies are tuples of references
+        std::get<1>(v[0]) = 10.5;
+        int id;
+        std::string name;
+        std::tie(id, std::ignore, name) = v[1];
+        std::cout << "row 1: " << id << " " << name << std::endl;
+
+        const SoAVector<int, double, std::string>& cv = v;
+        for (auto row : cv) {
+            std::cout << std::get<0>(row) << " " << std::get<1>(row) << " "
+                      << std::get<2>(row) << std::endl;
+        }
+
+        // columns are plain arrays
+        double sum = 0;
+        for (double d : v.column<1>())
+            sum += d;
+        std::cout << "column 1 sum: " << sum << std::endl;
+    }
+
+    // a throwing copy of the last component leaves all columns unchanged
+    {
+        SoAVector<int, std::string, FailingCopy> v;
+        v.push_back(1, "one", FailingCopy(false));
+        try {
+            v.push_back(2, "two", FailingCopy(true));
+        }
+        catch (std::exception& e) {
+            std::cout << "caught: " << e.what() << ", rows=" << v.size()
+                      << std::endl;
+        }
+        // the columns are still aligned: row 1 is the new row in all of them
+        v.push_back(3, "three", FailingCopy(false));
+        std::cout << "after retry: " << std::get<0>(v[1]) << " "
+                  << std::get<1>(v[1]) << std::endl;
+    }
+
+    // scan one 8-byte field of 72-byte records (eight 8-byte fields, plus the
+    // empty VTClass<> at the end padded to 8 bytes): array of structs versus
+    // structure of arrays
+    {
+        using AoS = VTClass<int64_t, double, double, double,
+                            double, double, double, double>;
+        using SoA = SoAVector<int64_t, double, double, double,
+                              double, double, double, double>;
+
+        const size_t rows = 4 * 1024 * 1024;
+        const size_t passes = 20;
+
+        std::vector<AoS> aos;
+        SoA soa;
+        aos.reserve(rows);
+        soa.reserve(rows);
+        for (size_t i = 0; i < rows; ++i) {
+            int64_t key = static_cast<int64_t>(i % 1000);
+            double d = static_cast<double>(i);
+            aos.emplace_back(key, d, d, d, d, d, d, d);
+            soa.push_back(key, d, d, d, d, d, d, d);
+        }
+
+        int64_t sum_aos = 0, sum_soa = 0;
+
+        auto start = std::chrono::steady_clock::now();
+        for (size_t p = 0; p < passes; ++p) {
+            for (const AoS& r : aos)
+                sum_aos += r.value_;
+        }
+        auto middle = std::chrono::steady_clock::now();
+        for (size_t p = 0; p < passes; ++p) {
+            for (int64_t key : soa.column<0>())
+                sum_soa += key;
+        }
+        auto stop = std::chrono::steady_clock::now();
+
+        double n = static_cast<double>(rows * passes);
+        std::cout << "sizeof(AoS row)=" << sizeof(AoS)
+                  << " ns/row: AoS="
+                  << std::chrono::duration<double, std::nano>(
+                      middle - start).count() / n
+                  << " SoA="
+                  << std::chrono::duration<double, std::nano>(
+                      stop - middle).count() / n
+                  << " (sums " << (sum_aos == sum_soa ? "equal" : "DIFFER")
+                  << ")" << std::endl;
+    }
+
+    return 0;
+}
@@ -0,0 +1,326 @@
+// flat tuple_cat() and apply() which move elements, benchmarked against
+// std::tuple_cat() and tlx::apply_tuple()
+
+#include <chrono>
+#include <cstddef>
+#include <iostream>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include <tlx/meta.hpp>
+
+namespace flat {
+
+/******************************************************************************/
+// tuple_cat in one step: element j of the result is element inner(j) of input
+// tuple outer(j). Both indices are computed by constexpr functions, and the
+// result is constructed from one pack expansion over j, without a chain of
+// intermediate tuples as in a recursive implementation. Elements of rvalue
+// input tuples are moved, those of lvalue tuples copied.
+
+//! maps result indexes to (tuple, element) for tuples of sizes Sizes...
+template <size_t... Sizes>
+struct CatIndex {
+    //! size of the concatenation
+    static constexpr size_t total() {
+        const size_t sizes[] = { Sizes..., 0 };
+        size_t sum = 0;
+        for (size_t s : sizes)
+            sum += s;
+        return sum;
+    }
+    //! input tuple of result element j
+    static constexpr size_t outer(size_t j) {
+        const size_t sizes[] = { Sizes..., 0 };
+        size_t t = 0;
+        while (j >= sizes[t])
+            j -= sizes[t++];
+        return t;
+    }
+    //! index of result element j in its input tuple
+    static constexpr size_t inner(size_t j) {
+        const size_t sizes[] = { Sizes..., 0 };
+        size_t t = 0;
+        while (j >= sizes[t])
+            j -= sizes[t++];
+        return j;
+    }
+};
+
+//! reference to the input tuple at position K
+template <size_t K, typename Type>
+struct PackLeaf {
+    Type&& value;
+};
+
+template <typename Indices, typename... Types>
+struct RefPack;
+
+//! references to a pack of arguments, held in flat base classes. Picking
+//! element K deduces the one matching base, instead of walking the recursive
+//! base class chain of std::tuple, as std::get on std::forward_as_tuple()
+//! would. This halved the compile time of tuple_cat() for 32 tuples.
+template <size_t... Ks, typename... Types>
+struct RefPack<std::index_sequence<Ks...>, Types...>
+    : PackLeaf<Ks, Types>...
+{
+    explicit RefPack(Types&&... values)
+        : PackLeaf<Ks, Types>{ std::forward<Types>(values) }... {}
+};
+
+template <typename... Types>
+using RefPackFor = RefPack<std::index_sequence_for<Types...>, Types...>;
+
+//! element K of a RefPack, with its original value category
+template <size_t K, typename Type>
+Type&& pick(PackLeaf<K, Type>& leaf) {
+    return std::forward<Type>(leaf.value);
+}
+
+//! type of element K of a RefPack, for decltype only
+template <size_t K, typename Type>
+Type pick_type(PackLeaf<K, Type>*);
+
+template <typename... Tuples>
+using CatIndexFor =
+    CatIndex<std::tuple_size<typename std::decay<Tuples>::type>::value...>;
+
+//! type of element J of the concatenation of Tuples
+template <size_t J, typename... Tuples>
+using cat_element = typename std::tuple_element<
+    CatIndexFor<Tuples...>::inner(J),
+    typename std::decay<decltype(
+        pick_type<CatIndexFor<Tuples...>::outer(J)>(
+            static_cast<RefPackFor<Tuples...>*>(nullptr)))>::type>::type;
+
+template <typename Indices, typename... Tuples>
+struct CatResult;
+
+template <size_t... Js, typename... Tuples>
+struct CatResult<std::index_sequence<Js...>, Tuples...> {
+    using type = std::tuple<cat_element<Js, Tuples...>...>;
+};
+
+//! type of the concatenation of Tuples
+template <typename... Tuples>
+using cat_result = typename CatResult<
+    std::make_index_sequence<CatIndexFor<Tuples...>::total()>,
+    Tuples...>::type;
+
+template <typename Result, typename Index, typename Pack, size_t... Js>
+Result tuple_cat_impl(Pack&& pack, std::index_sequence<Js...>) {
+    // pick() yields the input tuples with their original value category, and
+    // std::get on an rvalue input tuple yields an rvalue element, which is
+    // moved.
+    return Result(std::get<Index::inner(Js)>(pick<Index::outer(Js)>(pack))...);
+}
+
+//! concatenate any number of tuples into one
+template <typename... Tuples>
+cat_result<Tuples...> tuple_cat(Tuples&&... tuples) {
+    return tuple_cat_impl<cat_result<Tuples...>, CatIndexFor<Tuples...> >(
+        RefPackFor<Tuples...>(std::forward<Tuples>(tuples)...),
+        std::make_index_sequence<CatIndexFor<Tuples...>::total()>());
+}
+
+/******************************************************************************/
+
+template <typename Functor, typename Tuple, size_t... Is>
+decltype(auto) apply_impl(Functor&& f, Tuple&& t, std::index_sequence<Is...>) {
+    return std::forward<Functor>(f)(std::get<Is>(std::forward<Tuple>(t))...);
+}
+
+//! call f with the components of tuple t as arguments, which are moved if t
+//! is an rvalue. The return value is passed through, also references.
+template <typename Functor, typename Tuple>
+decltype(auto) apply(Functor&& f, Tuple&& t) {
+    return apply_impl(
+        std::forward<Functor>(f), std::forward<Tuple>(t),
+        std::make_index_sequence<
+            std::tuple_size<typename std::decay<Tuple>::type>::value>());
+}
+
+} // namespace flat
+
+/******************************************************************************/
+
+#ifdef COMPILE_BENCH_SIZE
+
+// compile time benchmark, see the Makefile target tuple-cat-compile-times:
+// for all n from 1 to COMPILE_BENCH_SIZE, concatenate n one-element tuples of
+// distinct types, or with COMPILE_BENCH_APPLY apply a function to a tuple of
+// n elements.
+
+#if COMPILE_BENCH_FLAT
+#define BENCH_CAT flat::tuple_cat
+#define BENCH_APPLY flat::apply
+#else
+#define BENCH_CAT std::tuple_cat
+#define BENCH_APPLY tlx::apply_tuple
+#endif
+
+template <size_t I>
+struct Element {
+    int value;
+};
+
+template <size_t... Is>
+int compile_bench(std::index_sequence<Is...>) {
+#if COMPILE_BENCH_APPLY
+    std::tuple<Element<Is>...> t(Element<Is>{ int(Is) }...);
+    return BENCH_APPLY(
+        [](const auto&... e) {
+            int sum = 0;
+            using VarForeachExpander = int[];
+            (void)VarForeachExpander{ 0, (sum += e.value, 0)... };
+            return sum;
+        }, t);
+#else
+    auto t = BENCH_CAT(std::make_tuple(Element<Is>{ int(Is) })...);
+    return std::get<sizeof...(Is) - 1>(t).value;
+#endif
+}
+
+template <size_t... Ns>
+int compile_bench_all(std::index_sequence<Ns...>) {
+    int sum = 0;
+    using VarForeachExpander = int[];
+    (void)VarForeachExpander{
+        0, (sum += compile_bench(std::make_index_sequence<Ns + 1>()), 0)...
+    };
+    return sum;
+}
+
+int main() {
+    return compile_bench_all(std::make_index_sequence<COMPILE_BENCH_SIZE>())
+           == 0;
+}
+
+#else // !COMPILE_BENCH_SIZE
+
+//! element type counting copies and moves, with a payload which is expensive
+//! to copy (too long for the small string optimization)
+struct Tracked {
+    static size_t copies, moves;
+
+    std::string payload = "a string payload which lives on the heap";
+
+    Tracked() = default;
+    Tracked(const Tracked& o) : payload(o.payload) { ++copies; }
+    Tracked(Tracked&& o) noexcept : payload(std::move(o.payload)) { ++moves; }
+    Tracked& operator = (const Tracked&) = default;
+    Tracked& operator = (Tracked&&) = default;
+};
+
+size_t Tracked::copies = 0;
+size_t Tracked::moves = 0;
+
+//! a tuple of n Tracked
+template <size_t... Is>
+auto make_tracked(std::index_sequence<Is...>) {
+    return std::make_tuple((void(Is), Tracked())...);
+}
+
+//! takes all arguments by value, hence they are moved or copied
+struct Consume {
+    template <typename... Types>
+    size_t operator () (Types... args) const {
+        size_t sum = 0;
+        using VarForeachExpander = int[];
+        (void)VarForeachExpander{ 0, (sum += args.payload.size(), 0)... };
+        return sum;
+    }
+};
+
+//! per call: copies, moves and nanoseconds
+struct Result {
+    double copies, moves, ns;
+};
+
+//! measure concatenating two rvalue tuples of Tracked with total size N and
+//! applying Consume to the moved result, with std::tuple_cat and
+//! tlx::apply_tuple or flat::tuple_cat and flat::apply
+template <size_t N, bool Flat>
+Result measure(size_t rounds) {
+    auto proto_a = make_tracked(std::make_index_sequence<N / 2>());
+    auto proto_b = make_tracked(std::make_index_sequence<N - N / 2>());
+
+    // copying the inputs costs the same for both, count it separately
+    size_t base_copies = 0;
+    size_t sum = 0;
+    Tracked::copies = Tracked::moves = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    for (size_t r = 0; r < rounds; ++r) {
+        size_t before = Tracked::copies;
+        auto a = proto_a;
+        auto b = proto_b;
+        base_copies += Tracked::copies - before;
+
+        if (Flat) {
+            auto c = flat::tuple_cat(std::move(a), std::move(b));
+            sum += flat::apply(Consume(), std::move(c));
+        }
+        else {
+            auto c = std::tuple_cat(std::move(a), std::move(b));
+            sum += tlx::apply_tuple(Consume(), std::move(c));
+        }
+    }
+    auto stop = std::chrono::steady_clock::now();
+
+    if (sum == 0)
+        std::cout << "unexpected sum" << std::endl;
+
+    return Result{
+        static_cast<double>(Tracked::copies - base_copies) / rounds,
+        static_cast<double>(Tracked::moves) / rounds,
+        std::chrono::duration<double, std::nano>(stop - start).count() / rounds
+    };
+}
+
+template <size_t N>
+void run(size_t rounds) {
+    Result s = measure<N, false>(rounds);
+    Result f = measure<N, true>(rounds);
+    std::cout << "size " << N
+              << ": std/tlx copies=" << s.copies << " moves=" << s.moves
+              << " ns=" << s.ns
+              << " | flat copies=" << f.copies << " moves=" << f.moves
+              << " ns=" << f.ns << std::endl;
+}
+
+template <size_t... Ns>
+void run_all(size_t rounds, std::index_sequence<Ns...>) {
+    using VarForeachExpander = int[];
+    (void)VarForeachExpander{ 0, (run<Ns>(rounds), 0)... };
+}
+
+int main() {
+    // the tuple part of test1() in variadic-templates.cpp
+    std::tuple<int, std::string> t(1, "hello");
+    auto t2 = flat::tuple_cat(t, std::make_tuple(42));
+    flat::apply(
+        [](const auto&... values) {
+            using VarForeachExpander = int[];
+            (void)VarForeachExpander{
+                0, (std::cout << values << std::endl, 0)...
+            };
+        },
+        t2);
+
+    // mixed lvalue and rvalue inputs: the lvalue tuple's elements are copied
+    Tracked::copies = Tracked::moves = 0;
+    std::tuple<Tracked> lvalue;
+    auto mixed = flat::tuple_cat(lvalue, std::tuple<Tracked>(), std::tuple<>());
+    std::cout << "mixed: size " << std::tuple_size<decltype(mixed)>::value
+              << " copies=" << Tracked::copies << " moves=" << Tracked::moves
+              << std::endl;
+
+    run_all(100000, std::index_sequence<1, 2, 4, 8, 16, 32, 64>());
+
+    return 0;
+}
+
+#endif // !COMPILE_BENCH_SIZE
@@ -0,0 +1,362 @@
+// small-buffer optimized move-only function wrapper: unique_function
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+#include <tlx/delegate.hpp>
+
+//! A non-copyable move-only buffer which contains a "large" memory area
+class Buffer {
+public:
+    //! allocate buffer containing n bytes
+    explicit Buffer(size_t n)
+        : data_(reinterpret_cast<char*>(operator new(n))), size_(n) {}
+
+    //! allocate buffer containing string str
+    explicit Buffer(const char* str) : Buffer(strlen(str)) {
+        std::copy(str, str + size_, data_);
+    }
+
+    //! non-copyable: delete copy-constructor
+    Buffer(const Buffer&) = delete;
+    //! non-copyable: delete assignment operator
+    Buffer& operator=(const Buffer&) = delete;
+
+    //! move-construct other buffer into this one
+    Buffer(Buffer&& other) noexcept : data_(other.data_), size_(other.size_) {
+        other.data_ = nullptr;
+        other.size_ = 0;
+    }
+
+    //! move-assignment of other buffer into this one
+    Buffer& operator=(Buffer&& other) noexcept {
+        if (this == &other)
+            return *this;
+
+        operator delete(data_);
+        data_ = other.data_;
+        size_ = other.size_;
+        other.data_ = nullptr;
+        other.size_ = 0;
+
+        return *this;
+    }
+
+    //! delete buffer
+    ~Buffer() { operator delete(data_); }
+
+    //! return as string
+    std::string to_string() const { return std::string(data_, size_); }
+
+    //! size of the buffer
+    size_t size() const { return size_; }
+
+private:
+    //! the buffer
+    char* data_;
+    //! buffer size
+    size_t size_;
+};
+
+/******************************************************************************/
+
+template <typename Signature, size_t InlineSize = 4 * sizeof(void*)>
+class unique_function;
+
+//! A move-only replacement for std::function. Callables of at most InlineSize
+//! bytes with a noexcept move constructor are stored inside the object, larger
+//! ones on the heap. Type erasure uses one static table of function pointers
+//! per callable type, instead of virtual functions, so no vtable pointer has to
+//! be stored inside the callable's storage.
+template <typename Return, typename... Args, size_t InlineSize>
+class unique_function<Return(Args...), InlineSize> {
+public:
+    //! empty function
+    unique_function() noexcept : ops_(nullptr) {}
+
+    //! store any callable, taking ownership by moving it in
+    template <typename Functor, typename = typename std::enable_if<
+                  !std::is_same<typename std::decay<Functor>::type,
+                                unique_function>::value>::type>
+    unique_function(Functor&& f) {
+        using F = typename std::decay<Functor>::type;
+        construct<F>(std::forward<Functor>(f), Inline<F>());
+    }
+
+    //! non-copyable: delete copy-constructor
+    unique_function(const unique_function&) = delete;
+    //! non-copyable: delete assignment operator
+    unique_function& operator=(const unique_function&) = delete;
+
+    //! move-construct: relocate the other's callable
+    unique_function(unique_function&& other) noexcept : ops_(other.ops_) {
+        if (ops_) {
+            relocate(other);
+            other.ops_ = nullptr;
+        }
+    }
+
+    //! move-assignment
+    unique_function& operator=(unique_function&& other) noexcept {
+        if (this == &other)
+            return *this;
+
+        reset();
+        ops_ = other.ops_;
+        if (ops_) {
+            relocate(other);
+            other.ops_ = nullptr;
+        }
+        return *this;
+    }
+
+    ~unique_function() { reset(); }
+
+    //! call the stored callable. const like std::function's, which also
+    //! calls a non-const callable. Throws std::bad_function_call if empty.
+    Return operator () (Args... args) const {
+        if (!ops_)
+            throw std::bad_function_call();
+        return ops_->invoke(&storage_, std::forward<Args>(args)...);
+    }
+
+    //! whether a callable is stored
+    explicit operator bool() const noexcept { return ops_ != nullptr; }
+
+    //! whether the callable is stored without heap allocation
+    bool is_inline() const noexcept { return ops_ && ops_->is_inline; }
+
+    //! destroy the stored callable
+    void reset() noexcept {
+        if (ops_) {
+            if (ops_->destroy)
+                ops_->destroy(&storage_);
+            ops_ = nullptr;
+        }
+    }
+
+private:
+    using Storage = typename std::aligned_storage<
+        (InlineSize < sizeof(void*) ? sizeof(void*) : InlineSize)>::type;
+
+    //! table of type-erased operations on the storage. relocate and destroy
+    //! are nullptr for trivial callables, which are simply copied bytewise.
+    struct Ops {
+        Return (* invoke)(void* storage, Args&&... args);
+        //! move-construct into dst from src, then destroy src
+        void (* relocate)(void* dst, void* src) noexcept;
+        void (* destroy)(void* storage) noexcept;
+        bool is_inline;
+    };
+
+    //! callables are stored inline only if they fit and cannot throw on move
+    template <typename F>
+    struct Inline : std::integral_constant<
+                        bool, sizeof(F) <= sizeof(Storage) &&
+                        alignof(Storage) % alignof(F) == 0 &&
+                        std::is_nothrow_move_constructible<F>::value> { };
+
+    template <typename F>
+    struct InlineOps {
+        static Return invoke(void* s, Args&&... args) {
+            return (*static_cast<F*>(s))(std::forward<Args>(args)...);
+        }
+        static void relocate(void* dst, void* src) noexcept {
+            new (dst) F(std::move(*static_cast<F*>(src)));
+            static_cast<F*>(src)->~F();
+        }
+        static void destroy(void* s) noexcept { static_cast<F*>(s)->~F(); }
+
+        static constexpr bool trivial =
+            std::is_trivially_copyable<F>::value &&
+            std::is_trivially_destructible<F>::value;
+
+        static constexpr Ops ops = {
+            invoke, trivial ? nullptr : relocate, trivial ? nullptr : destroy,
+            true
+        };
+    };
+
+    template <typename F>
+    struct HeapOps {
+        static F*& ptr(void* s) { return *static_cast<F**>(s); }
+
+        static Return invoke(void* s, Args&&... args) {
+            return (*ptr(s))(std::forward<Args>(args)...);
+        }
+        static void relocate(void* dst, void* src) noexcept {
+            ptr(dst) = ptr(src);
+        }
+        static void destroy(void* s) noexcept { delete ptr(s); }
+
+        static constexpr Ops ops = { invoke, relocate, destroy, false };
+    };
+
+    //! move the callable from other's storage into ours
+    void relocate(unique_function& other) noexcept {
+        if (ops_->relocate)
+            ops_->relocate(&storage_, &other.storage_);
+        else
+            storage_ = other.storage_;
+    }
+
+    //! store callable inside the object
+    template <typename F, typename Functor>
+    void construct(Functor&& f, std::true_type /* inline */) {
+        new (&storage_) F(std::forward<Functor>(f));
+        ops_ = &InlineOps<F>::ops;
+    }
+
+    //! store callable on the heap and a pointer to it inside the object
+    template <typename F, typename Functor>
+    void construct(Functor&& f, std::false_type /* inline */) {
+        new (&storage_) F*(new F(std::forward<Functor>(f)));
+        ops_ = &HeapOps<F>::ops;
+    }
+
+    //! operations for the stored callable, nullptr if empty
+    const Ops* ops_;
+    //! the callable or a pointer to it, mutable for the const operator ()
+    mutable Storage storage_;
+};
+
+// out-of-class definitions of the static constexpr members, required in C++14
+template <typename Return, typename... Args, size_t InlineSize>
+template <typename F>
+constexpr typename unique_function<Return(Args...), InlineSize>::Ops
+unique_function<Return(Args...), InlineSize>::InlineOps<F>::ops;
+
+template <typename Return, typename... Args, size_t InlineSize>
+template <typename F>
+constexpr typename unique_function<Return(Args...), InlineSize>::Ops
+unique_function<Return(Args...), InlineSize>::HeapOps<F>::ops;
+
+/******************************************************************************/
+
+//! measure constructing, moving and calling a function wrapper holding a
+//! closure created by make_closure(i). returns nanoseconds per iteration.
+template <typename Function, typename MakeClosure>
+double benchmark(size_t rounds, MakeClosure make_closure) {
+    size_t sum = 0;
+    auto start = std::chrono::steady_clock::now();
+
+    for (size_t i = 0; i < rounds; ++i) {
+        Function f = make_closure(i);
+        Function g = std::move(f);
+        sum += g();
+    }
+
+    auto stop = std::chrono::steady_clock::now();
+    if (sum == 1)
+        std::cout << "sum " << sum << std::endl;
+    return std::chrono::duration<double, std::nano>(stop - start).count()
+           / rounds;
+}
+
+//! measure only calling a function wrapper. returns nanoseconds per call.
+template <typename Function>
+double benchmark_call(size_t rounds, Function& f) {
+    size_t sum = 0;
+    auto start = std::chrono::steady_clock::now();
+
+    for (size_t i = 0; i < rounds; ++i)
+        sum += f();
+
+    auto stop = std::chrono::steady_clock::now();
+    if (sum == 1)
+        std::cout << "sum " << sum << std::endl;
+    return std::chrono::duration<double, std::nano>(stop - start).count()
+           / rounds;
+}
+
+int main() {
+    // a closure capturing a Buffer by move is stored inline
+    {
+        Buffer bl("unique_function buffer");
+
+        unique_function<void()> print_function = [bl = std::move(bl)]() {
+            std::cout << bl.to_string() << std::endl;
+        };
+        print_function();
+
+        // moving the wrapper moves the closure and with it the Buffer
+        unique_function<void()> moved = std::move(print_function);
+        moved();
+        std::cout << "inline=" << moved.is_inline()
+                  << " sizeof=" << sizeof(moved) << std::endl;
+
+        // a larger capture does not fit and goes to the heap
+        char large[64] = "large closure";
+        unique_function<void()> heap = [large]() {
+            std::cout << large << std::endl;
+        };
+        heap();
+        std::cout << "inline=" << heap.is_inline() << std::endl;
+
+        // callable through a const reference, like std::function
+        const unique_function<void()>& const_ref = moved;
+        const_ref();
+
+        // calling an empty function throws
+        try {
+            unique_function<void()> empty;
+            empty();
+        }
+        catch (std::bad_function_call& e) {
+            std::cout << "empty: " << e.what() << std::endl;
+        }
+    }
+
+    // construction + move + call. std::function requires copyable closures,
+    // hence all variants capture a copyable 16 byte payload here.
+    const size_t rounds = 10000000;
+    auto make_closure = [](size_t i) {
+        size_t a = i, b = i * 2;
+        return [a, b]() { return a + b; };
+    };
+
+    std::cout << "construct+move+call ns: std::function="
+              << benchmark<std::function<size_t()> >(rounds, make_closure)
+              << " tlx::delegate="
+              << benchmark<tlx::delegate<size_t()> >(rounds, make_closure)
+              << " unique_function="
+              << benchmark<unique_function<size_t()> >(rounds, make_closure)
+              << std::endl;
+
+    // a move-only closure with a Buffer: std::function cannot hold it
+    auto make_buffer_closure = [](size_t i) {
+        Buffer b(16);
+        return [b = std::move(b), i]() { return b.size() + i; };
+    };
+
+    std::cout << "construct+move+call with Buffer ns: tlx::delegate="
+              << benchmark<tlx::delegate<size_t()> >(
+                  rounds, make_buffer_closure)
+              << " unique_function="
+              << benchmark<unique_function<size_t()> >(
+                  rounds, make_buffer_closure)
+              << std::endl;
+
+    // calling only
+    {
+        std::function<size_t()> f1 = make_closure(1);
+        tlx::delegate<size_t()> f2 = make_closure(1);
+        unique_function<size_t()> f3 = make_closure(1);
+
+        std::cout << "call ns: std::function=" << benchmark_call(rounds, f1)
+                  << " tlx::delegate=" << benchmark_call(rounds, f2)
+                  << " unique_function=" << benchmark_call(rounds, f3)
+                  << std::endl;
+    }
+
+    return 0;
+}
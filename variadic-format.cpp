@@ -0,0 +1,426 @@
+// non-recursive variadic print: format all arguments into a stack buffer in
+// one pass and emit them with a single write
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+//! the recursive print functions from variadic-templates.cpp, for comparison
+template <typename Type>
+void print_recursive(const Type& t) {
+    std::cout << t << std::endl;
+}
+
+template <typename Type, typename... MoreTypes>
+void print_recursive(const Type& t, const MoreTypes&... more) {
+    print_recursive(t);
+    print_recursive(more...);
+}
+
+/******************************************************************************/
+
+//! Output buffer which lives on the stack and only moves to the heap if the
+//! formatted output exceeds kStackSize bytes.
+class FormatBuffer {
+public:
+    static constexpr size_t kStackSize = 512;
+
+    FormatBuffer() = default;
+
+    //! non-copyable: delete copy-constructor
+    FormatBuffer(const FormatBuffer&) = delete;
+    //! non-copyable: delete assignment operator
+    FormatBuffer& operator=(const FormatBuffer&) = delete;
+
+    //! return pointer to at least n writable bytes at the end
+    char* reserve(size_t n) {
+        if (size_ + n > capacity_)
+            grow(size_ + n);
+        return data_ + size_;
+    }
+
+    //! mark n bytes written at reserve()'s pointer as used
+    void commit(size_t n) { size_ += n; }
+
+    void append(const char* s, size_t n) {
+        std::memcpy(reserve(n), s, n);
+        commit(n);
+    }
+
+    void append(char c) {
+        *reserve(1) = c;
+        commit(1);
+    }
+
+    const char* data() const { return data_; }
+    size_t size() const { return size_; }
+
+private:
+    void grow(size_t n) {
+        size_t capacity = std::max(n, 2 * capacity_);
+        std::unique_ptr<char[]> heap(new char[capacity]);
+        std::memcpy(heap.get(), data_, size_);
+        heap_ = std::move(heap);
+        data_ = heap_.get();
+        capacity_ = capacity;
+    }
+
+    char stack_[kStackSize];
+    std::unique_ptr<char[]> heap_;
+    char* data_ = stack_;
+    size_t size_ = 0;
+    size_t capacity_ = kStackSize;
+};
+
+/******************************************************************************/
+// formatting of single values. each overload appends to the buffer without
+// any locale lookups, virtual calls or temporary strings, except the generic
+// fallback for all other types at the end.
+
+//! two-digit lookup table: converts two decimal digits per division
+static const char kDigitPairs[] =
+    "000102030405060708091011121314151617181920212223242526272829"
+    "303132333435363738394041424344454647484950515253545556575859"
+    "606162636465666768697071727374757677787980818283848586878889"
+    "90919293949596979899";
+
+//! write unsigned v backwards ending at end, return pointer to first digit
+inline char* format_digits(char* end, uint64_t v) {
+    while (v >= 100) {
+        unsigned pair = static_cast<unsigned>(v % 100) * 2;
+        v /= 100;
+        *--end = kDigitPairs[pair + 1];
+        *--end = kDigitPairs[pair];
+    }
+    if (v >= 10) {
+        unsigned pair = static_cast<unsigned>(v) * 2;
+        *--end = kDigitPairs[pair + 1];
+        *--end = kDigitPairs[pair];
+    }
+    else {
+        *--end = static_cast<char>('0' + v);
+    }
+    return end;
+}
+
+//! integers: fast path via the digit pair table
+template <typename Type>
+typename std::enable_if<std::is_integral<Type>::value>::type
+format_value(FormatBuffer& buf, const Type& value) {
+    char tmp[24];
+    char* end = tmp + sizeof(tmp);
+    uint64_t v = static_cast<uint64_t>(value);
+    bool negative = std::is_signed<Type>::value && value < 0;
+    if (negative)
+        v = ~v + 1;
+    char* begin = format_digits(end, v);
+    if (negative)
+        *--begin = '-';
+    buf.append(begin, end - begin);
+}
+
+//! bool as 0 or 1, as std::cout does by default
+inline void format_value(FormatBuffer& buf, bool value) {
+    buf.append(value ? '1' : '0');
+}
+
+//! characters are output as such, also signed and unsigned char, which
+//! std::ostream prints as characters, too
+inline void format_value(FormatBuffer& buf, char value) { buf.append(value); }
+
+inline void format_value(FormatBuffer& buf, signed char value) {
+    buf.append(static_cast<char>(value));
+}
+
+inline void format_value(FormatBuffer& buf, unsigned char value) {
+    buf.append(static_cast<char>(value));
+}
+
+//! floating point via snprintf(), which rounds the exact binary value half
+//! to even, like std::cout (the "C" locale is assumed).
+inline void format_value_slow(FormatBuffer& buf, double value) {
+    char* p = buf.reserve(32);
+    buf.commit(std::snprintf(p, 32, "%g", value));
+}
+
+//! floating point: like std::cout's default (%g with six significant digits).
+//! The common case is formatted via integer arithmetic: the value is scaled
+//! such that six digits are left of the point and rounded to an integer. The
+//! scaling error is below 1e-9, hence the rounding is exact unless the
+//! fraction is that close to a tie. Such near-ties, results which need an
+//! exponent, and a carry to seven digits (which changes the exponent, as in
+//! 999999.7 -> 1e+06) are left to snprintf().
+inline void format_value(FormatBuffer& buf, double value) {
+    // nan and inf, with their sign, as snprintf() and std::cout print them
+    if (!std::isfinite(value))
+        return format_value_slow(buf, value);
+    // signbit() instead of < 0, for -0
+    if (std::signbit(value)) {
+        buf.append('-');
+        value = -value;
+    }
+    if (value == 0)
+        return buf.append('0');
+
+    int exponent = static_cast<int>(std::floor(std::log10(value)));
+    if (exponent < -4 || exponent >= 6)
+        return format_value_slow(buf, value);
+
+    // six significant digits: scale to [1e5, 1e6) and round
+    static const uint64_t kPow10[] = {
+        1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000,
+        1000000000, 10000000000
+    };
+    int precision = 5 - exponent;
+    double scaled_value = value * static_cast<double>(kPow10[precision]);
+    double floor_value = std::floor(scaled_value);
+    double fraction_value = scaled_value - floor_value;
+    if (floor_value < 1e5 || floor_value + fraction_value >= 999999.5 ||
+        std::fabs(fraction_value - 0.5) < 1e-9) {
+        // log10() was inexact, a carry to 1e6, or a near-tie
+        return format_value_slow(buf, value);
+    }
+    uint64_t scaled =
+        static_cast<uint64_t>(floor_value) + (fraction_value > 0.5 ? 1 : 0);
+    uint64_t integer = scaled / kPow10[precision];
+    uint64_t fraction = scaled % kPow10[precision];
+
+    char tmp[32];
+    char* end = tmp + sizeof(tmp);
+    char* begin = end;
+    if (fraction != 0) {
+        // remove trailing zeros, then pad with leading zeros
+        while (fraction % 10 == 0)
+            fraction /= 10, --precision;
+        begin = format_digits(end, fraction);
+        while (end - begin < precision)
+            *--begin = '0';
+        *--begin = '.';
+    }
+    begin = format_digits(begin, integer);
+    buf.append(begin, end - begin);
+}
+
+inline void format_value(FormatBuffer& buf, float value) {
+    format_value(buf, static_cast<double>(value));
+}
+
+inline void format_value(FormatBuffer& buf, const char* value) {
+    buf.append(value, std::strlen(value));
+}
+
+inline void format_value(FormatBuffer& buf, const std::string& value) {
+    buf.append(value.data(), value.size());
+}
+
+//! other pointers as addresses in hex, like std::cout: 0 for null, else 0x...
+inline void format_value(FormatBuffer& buf, const void* value) {
+    uintptr_t v = reinterpret_cast<uintptr_t>(value);
+    if (v == 0)
+        return buf.append('0');
+    char tmp[2 + 2 * sizeof(v)];
+    char* end = tmp + sizeof(tmp);
+    char* begin = end;
+    for ( ; v != 0; v >>= 4)
+        *--begin = "0123456789abcdef"[v & 15];
+    *--begin = 'x';
+    *--begin = '0';
+    buf.append(begin, end - begin);
+}
+
+//! nullptr as std::cout prints it since C++17
+inline void format_value(FormatBuffer& buf, std::nullptr_t) {
+    buf.append("nullptr", 7);
+}
+
+//! std::streambuf which appends to a FormatBuffer
+class FormatStreamBuf : public std::streambuf {
+public:
+    explicit FormatStreamBuf(FormatBuffer& buf) : buf_(buf) {}
+
+protected:
+    int_type overflow(int_type c) override {
+        if (!traits_type::eq_int_type(c, traits_type::eof()))
+            buf_.append(traits_type::to_char_type(c));
+        return traits_type::not_eof(c);
+    }
+
+    std::streamsize xsputn(const char* s, std::streamsize n) override {
+        buf_.append(s, static_cast<size_t>(n));
+        return n;
+    }
+
+private:
+    FormatBuffer& buf_;
+};
+
+//! whether Type is handled by one of the overloads above: integers, float,
+//! double, strings and pointers (arrays decay to pointers).
+template <typename Type>
+struct HasFastFormat
+    : std::integral_constant<
+          bool, std::is_integral<Type>::value ||
+          std::is_same<Type, float>::value ||
+          std::is_same<Type, double>::value ||
+          std::is_same<Type, std::string>::value ||
+          std::is_same<Type, std::nullptr_t>::value ||
+          std::is_pointer<Type>::value || std::is_array<Type>::value> { };
+
+//! all other types, e.g. long double, enums and user types with an
+//! operator <<: formatted by a std::ostream writing into the buffer. This is
+//! slower, but accepts everything that print_recursive() accepts.
+template <typename Type>
+typename std::enable_if<!HasFastFormat<Type>::value>::type
+format_value(FormatBuffer& buf, const Type& value) {
+    FormatStreamBuf streambuf(buf);
+    std::ostream os(&streambuf);
+    os << value;
+}
+
+/******************************************************************************/
+
+//! format all values into buf, each followed by separator
+template <typename... Types>
+void format_all(FormatBuffer& buf, char separator, const Types&... values) {
+    // one pass over the pack without recursion: execute a function on each
+    // parameter (the kludge from variadic-templates.cpp)
+    using VarForeachExpander = int[];
+    (void)VarForeachExpander{
+        0, (format_value(buf, values), buf.append(separator), 0)...
+    };
+}
+
+//! print function with any number of parameters of any supported type. the
+//! output is the same as print() in variadic-templates.cpp, one value per
+//! line, but is assembled on the stack and written to std::cout only once,
+//! without flushing.
+template <typename... Types>
+void print(const Types&... values) {
+    FormatBuffer buf;
+    format_all(buf, '\n', values...);
+    std::cout.write(buf.data(), buf.size());
+}
+
+//! format values separated by spaces into a std::string
+template <typename... Types>
+std::string format(const Types&... values) {
+    FormatBuffer buf;
+    format_all(buf, ' ', values...);
+    return std::string(buf.data(), buf.size() ? buf.size() - 1 : 0);
+}
+
+//! a user type with an operator <<, handled by the generic format_value()
+struct Point {
+    int x, y;
+};
+
+std::ostream& operator << (std::ostream& os, const Point& p) {
+    return os << '(' << p.x << ", " << p.y << ')';
+}
+
+//! run print_function many times with std::cout sent to /dev/null, return
+//! nanoseconds per call.
+template <typename PrintFunction>
+double benchmark(size_t rounds, PrintFunction print_function) {
+    std::ofstream null("/dev/null");
+    std::streambuf* old = std::cout.rdbuf(null.rdbuf());
+
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < rounds; ++i)
+        print_function(i);
+    std::cout.flush();
+    auto stop = std::chrono::steady_clock::now();
+
+    std::cout.rdbuf(old);
+    return std::chrono::duration<double, std::nano>(stop - start).count()
+           / rounds;
+}
+
+int main() {
+    // same call syntax and output as the recursive version
+    print(5);
+    print(5, "hello", 42.0);
+    print_recursive(5, "hello", 42.0);
+
+    // compare floating point output with std::cout's
+    for (double d : { 3.14159265, 0.001, 123456.7, -2.5e-7, 1e10, 0.1 }) {
+        std::cout << format(d) << " == ";
+        std::cout << d << std::endl;
+    }
+    std::cout << format(-42, 'x', std::string("string"), true, 7u,
+                        static_cast<unsigned char>(65),
+                        static_cast<signed char>(66))
+              << std::endl;
+
+    // pointers print as addresses, other types via their operator <<
+    {
+        int x = 0;
+        std::ostringstream oss;
+        oss << &x << " " << static_cast<int*>(nullptr) << " " << 1.25L
+            << " " << Point{ 1, 2 };
+        std::cout << format(&x, static_cast<int*>(nullptr), 1.25L,
+                            Point{ 1, 2 }, nullptr)
+                  << " == " << oss.str() << " nullptr" << std::endl;
+    }
+
+    // regression checks against std::ostream: rounding ties (half to even
+    // on the exact binary value), carries into the exponent, and many
+    // pseudo-random values of all magnitudes.
+    {
+        std::vector<double> values = {
+            999999.5, 999999.7, 123456.5, 99999.95, 0.5, 2.5, 1234565,
+            0.000123456789, 0.0000999996, 9.999995, 1e-4, 1e5, 1e6,
+            -0.0, NAN, -NAN, INFINITY, -INFINITY
+        };
+        uint64_t x = 42;
+        for (size_t i = 0; i < 100000; ++i) {
+            x = x * 6364136223846793005u + 1442695040888963407u;
+            double mantissa = static_cast<double>(x >> 11) / (1ull << 53);
+            int exponent = static_cast<int>(x % 15) - 6;
+            values.push_back(mantissa * std::pow(10.0, exponent));
+            // also values with at most seven significant digits, many ties
+            values.push_back(static_cast<double>(x % 10000000) /
+                             std::pow(10.0, static_cast<int>(x % 9)));
+        }
+
+        size_t mismatches = 0;
+        for (double d : values) {
+            std::ostringstream oss;
+            oss << d;
+            if (format(d) != oss.str()) {
+                if (++mismatches <= 5) {
+                    std::cout << "MISMATCH: " << format(d) << " != "
+                              << oss.str() << std::endl;
+                }
+            }
+        }
+        std::cout << "double formatting: " << values.size() - mismatches
+                  << " of " << values.size() << " match std::ostream"
+                  << std::endl;
+    }
+
+    const size_t rounds = 200000;
+    double t_recursive = benchmark(rounds, [](size_t i) {
+        print_recursive(i, "hello", 42.5, -7);
+    });
+    double t_onepass = benchmark(rounds, [](size_t i) {
+        print(i, "hello", 42.5, -7);
+    });
+
+    std::cout << "ns/call: recursive print=" << t_recursive
+              << " one-pass print=" << t_onepass << std::endl;
+
+    return 0;
+}
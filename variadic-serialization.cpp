@@ -0,0 +1,427 @@
+// variadic binary serialization: serialize(sink, args...) and
+// deserialize<Types...>(source)
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <new>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <sys/types.h>
+
+//! A non-copyable move-only growable buffer, serialization target
+class Buffer {
+public:
+    //! empty buffer
+    Buffer() : data_(nullptr), size_(0), capacity_(0) {}
+
+    //! non-copyable: delete copy-constructor
+    Buffer(const Buffer&) = delete;
+    //! non-copyable: delete assignment operator
+    Buffer& operator=(const Buffer&) = delete;
+
+    //! move-construct other buffer into this one
+    Buffer(Buffer&& other) noexcept
+        : data_(other.data_), size_(other.size_), capacity_(other.capacity_) {
+        other.data_ = nullptr;
+        other.size_ = other.capacity_ = 0;
+    }
+
+    //! delete buffer
+    ~Buffer() { std::free(data_); }
+
+    //! append n bytes, growing the capacity geometrically
+    void append(const char* data, size_t n) {
+        if (size_ + n > capacity_) {
+            size_t capacity = std::max(size_ + n, 2 * capacity_);
+            char* p = static_cast<char*>(std::realloc(data_, capacity));
+            if (p == nullptr)
+                throw std::bad_alloc();
+            data_ = p;
+            capacity_ = capacity;
+        }
+        std::memcpy(data_ + size_, data, n);
+        size_ += n;
+    }
+
+    //! set size to zero, keeping the capacity
+    void clear() { size_ = 0; }
+
+    //! pointer to the buffer's memory
+    const char* data() const { return data_; }
+
+    //! size of the buffer
+    size_t size() const { return size_; }
+
+private:
+    //! the buffer
+    char* data_;
+    //! used bytes
+    size_t size_;
+    //! allocated bytes
+    size_t capacity_;
+};
+
+class FileIo
+{
+public:
+    virtual ~FileIo() = default;
+    virtual ssize_t write(const char* data, size_t size) = 0;
+    void write_string(const std::string& str) { write(str.data(), str.size()); }
+};
+
+//! FileIo counting bytes only
+class CountingFile final : public FileIo
+{
+public:
+    ssize_t write(const char* /* data */, size_t size) final {
+        bytes_ += size;
+        return size;
+    }
+
+    size_t bytes() const { return bytes_; }
+
+private:
+    size_t bytes_ = 0;
+};
+
+/******************************************************************************/
+// sinks and sources: serialization writes to anything with an overload of
+// sink_write(), and reads from a Reader over contiguous memory.
+
+inline void sink_write(Buffer& b, const char* data, size_t size) {
+    b.append(data, size);
+}
+
+inline void sink_write(FileIo& f, const char* data, size_t size) {
+    f.write(data, size);
+}
+
+//! reads consecutive bytes from contiguous memory, e.g. a Buffer
+class Reader {
+public:
+    Reader(const char* data, size_t size) : pos_(data), end_(data + size) {}
+
+    explicit Reader(const Buffer& b) : Reader(b.data(), b.size()) {}
+
+    //! return pointer to the next size bytes and skip them
+    const char* read(size_t size) {
+        if (static_cast<size_t>(end_ - pos_) < size)
+            throw std::runtime_error("deserialize: read beyond end");
+        const char* p = pos_;
+        pos_ += size;
+        return p;
+    }
+
+    //! whether all bytes were consumed
+    bool empty() const { return pos_ == end_; }
+
+    //! number of bytes left
+    size_t remaining() const { return end_ - pos_; }
+
+private:
+    const char* pos_;
+    const char* end_;
+};
+
+/******************************************************************************/
+// Encoding of types: a class template with static write() and read()
+// functions, specialized for groups of types via std::enable_if.
+
+template <typename Type, typename Enable = void>
+struct Serialization;
+
+//! unsigned integers (and bool): varint with 7 bits per byte, the high bit
+//! marks continuation. small values, which are common, take one byte.
+template <typename Type>
+struct Serialization<Type, typename std::enable_if<
+                               std::is_integral<Type>::value &&
+                               !std::is_signed<Type>::value>::type> {
+    template <typename Sink>
+    static void write(Sink& sink, const Type& value) {
+        char bytes[10];
+        size_t n = 0;
+        uint64_t v = value;
+        while (v >= 0x80) {
+            bytes[n++] = static_cast<char>(v | 0x80);
+            v >>= 7;
+        }
+        bytes[n++] = static_cast<char>(v);
+        sink_write(sink, bytes, n);
+    }
+    static Type read(Reader& r) {
+        uint64_t v = 0;
+        for (unsigned shift = 0; shift < 64; shift += 7) {
+            uint8_t b = static_cast<uint8_t>(*r.read(1));
+            v |= static_cast<uint64_t>(b & 0x7F) << shift;
+            if (!(b & 0x80))
+                return static_cast<Type>(v);
+        }
+        throw std::runtime_error("deserialize: varint too long");
+    }
+};
+
+//! signed integers: zigzag mapping to unsigned (0, -1, 1, -2, ... to 0, 1, 2,
+//! 3, ...), such that small negative values are short, too.
+template <typename Type>
+struct Serialization<Type, typename std::enable_if<
+                               std::is_integral<Type>::value &&
+                               std::is_signed<Type>::value>::type> {
+    template <typename Sink>
+    static void write(Sink& sink, const Type& value) {
+        uint64_t v = static_cast<uint64_t>(static_cast<int64_t>(value));
+        uint64_t zigzag = (v << 1) ^ (value < 0 ? ~uint64_t(0) : 0);
+        Serialization<uint64_t>::write(sink, zigzag);
+    }
+    static Type read(Reader& r) {
+        uint64_t v = Serialization<uint64_t>::read(r);
+        return static_cast<Type>(
+            static_cast<int64_t>((v >> 1) ^ (~(v & 1) + 1)));
+    }
+};
+
+//! floating point: raw bytes
+template <typename Type>
+struct Serialization<Type, typename std::enable_if<
+                               std::is_floating_point<Type>::value>::type> {
+    template <typename Sink>
+    static void write(Sink& sink, const Type& value) {
+        sink_write(sink, reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+    static Type read(Reader& r) {
+        Type value;
+        std::memcpy(&value, r.read(sizeof(value)), sizeof(value));
+        return value;
+    }
+};
+
+//! strings: varint length and characters
+template <>
+struct Serialization<std::string> {
+    template <typename Sink>
+    static void write(Sink& sink, const std::string& value) {
+        Serialization<size_t>::write(sink, value.size());
+        sink_write(sink, value.data(), value.size());
+    }
+    static std::string read(Reader& r) {
+        size_t size = Serialization<size_t>::read(r);
+        return std::string(r.read(size), size);
+    }
+};
+
+//! C strings and string literals: the same encoding as std::string, hence
+//! they are read back as std::string. there is no read(), since a pointer
+//! cannot own the characters.
+template <>
+struct Serialization<const char*> {
+    template <typename Sink>
+    static void write(Sink& sink, const char* value) {
+        size_t size = std::strlen(value);
+        Serialization<size_t>::write(sink, size);
+        sink_write(sink, value, size);
+    }
+};
+
+template <>
+struct Serialization<char*> : Serialization<const char*> { };
+
+//! char arrays, as deduced for string literals: up to the first zero, but
+//! never beyond the array
+template <size_t N>
+struct Serialization<char[N]> {
+    template <typename Sink>
+    static void write(Sink& sink, const char (&value)[N]) {
+        size_t size = std::find(value, value + N, 0) - value;
+        Serialization<size_t>::write(sink, size);
+        sink_write(sink, value, size);
+    }
+};
+
+//! vectors: varint length and items. items are appended one by one, and the
+//! initial reservation is bounded by the remaining input, such that a corrupt
+//! length cannot cause a huge allocation. std::vector<bool> works too, since
+//! items are neither bound to Type& nor assigned through references.
+template <typename Type>
+struct Serialization<std::vector<Type> > {
+    template <typename Sink>
+    static void write(Sink& sink, const std::vector<Type>& value) {
+        Serialization<size_t>::write(sink, value.size());
+        for (const Type& item : value)
+            Serialization<Type>::write(sink, item);
+    }
+    static std::vector<Type> read(Reader& r) {
+        size_t size = Serialization<size_t>::read(r);
+        std::vector<Type> value;
+        value.reserve(std::min(size, r.remaining()));
+        for (size_t i = 0; i < size; ++i)
+            value.push_back(Serialization<Type>::read(r));
+        return value;
+    }
+};
+
+//! pairs: both components
+template <typename First, typename Second>
+struct Serialization<std::pair<First, Second> > {
+    template <typename Sink>
+    static void write(Sink& sink, const std::pair<First, Second>& value) {
+        Serialization<First>::write(sink, value.first);
+        Serialization<Second>::write(sink, value.second);
+    }
+    static std::pair<First, Second> read(Reader& r) {
+        // two statements: the order of function arguments is unspecified
+        First first = Serialization<First>::read(r);
+        return std::pair<First, Second>(
+            std::move(first), Serialization<Second>::read(r));
+    }
+};
+
+//! tuples: all components in order
+template <typename... Types>
+struct Serialization<std::tuple<Types...> > {
+    template <typename Sink>
+    static void write(Sink& sink, const std::tuple<Types...>& value) {
+        write(sink, value, std::index_sequence_for<Types...>());
+    }
+    static std::tuple<Types...> read(Reader& r) {
+        // braced initializer lists are evaluated left to right, unlike
+        // function arguments, hence components are read in order.
+        return std::tuple<Types...>{ Serialization<Types>::read(r)... };
+    }
+
+private:
+    template <typename Sink, size_t... Is>
+    static void write(Sink& sink, const std::tuple<Types...>& value,
+                      std::index_sequence<Is...>) {
+        using VarForeachExpander = int[];
+        (void)VarForeachExpander{
+            0, (Serialization<Types>::write(sink, std::get<Is>(value)), 0)...
+        };
+    }
+};
+
+/******************************************************************************/
+
+//! serialize any number of values of any supported types into sink
+template <typename Sink, typename... Types>
+void serialize(Sink& sink, const Types&... values) {
+    // the kludge from variadic-templates.cpp: execute a function on each
+    // parameter. The leading 0 allows empty packs.
+    using VarForeachExpander = int[];
+    (void)VarForeachExpander{
+        0, (Serialization<Types>::write(sink, values), 0)...
+    };
+}
+
+//! deserialize values of the given types, in order, returned as a tuple
+template <typename... Types>
+std::tuple<Types...> deserialize(Reader& r) {
+    return Serialization<std::tuple<Types...> >::read(r);
+}
+
+//! print tuple components separated by spaces
+template <typename Tuple, size_t... Is>
+void print_tuple(const Tuple& t, std::index_sequence<Is...>) {
+    using VarForeachExpander = int[];
+    (void)VarForeachExpander{ 0, (std::cout << std::get<Is>(t) << ' ', 0)... };
+    std::cout << std::endl;
+}
+
+int main() {
+    // serialize a record and read it back
+    {
+        Buffer b;
+        serialize(b, 5, -42L, 3.25, std::string("hello"), true,
+                  std::make_tuple(uint8_t(7), 1.5f),
+                  std::vector<int>{ 1, 2, 3 });
+        std::cout << "serialized into " << b.size() << " bytes" << std::endl;
+
+        Reader r(b);
+        auto t = deserialize<int, long, double, std::string, bool,
+                             std::tuple<uint8_t, float>, std::vector<int> >(r);
+        print_tuple(t, std::make_index_sequence<5>());
+        std::cout << "float in nested tuple: " << std::get<1>(std::get<5>(t))
+                  << ", vector size: " << std::get<6>(t).size()
+                  << ", all consumed: " << r.empty() << std::endl;
+
+        // the same works directly on a FileIo
+        CountingFile file;
+        serialize(file, 5, std::string("hello"));
+        std::cout << "serialized into FileIo: " << file.bytes() << " bytes"
+                  << std::endl;
+    }
+
+    // the arguments of print(5, "hello", 42.0): the string literal is read
+    // back as std::string
+    {
+        Buffer b;
+        serialize(b, 5, "hello", 42.0, std::vector<bool>{ true, false, true });
+        Reader r(b);
+        auto t = deserialize<int, std::string, double, std::vector<bool> >(r);
+        print_tuple(t, std::make_index_sequence<3>());
+        std::cout << "vector<bool>: " << std::get<3>(t)[0] << std::get<3>(t)[1]
+                  << std::get<3>(t)[2] << std::endl;
+    }
+
+    // a corrupt vector length fails at the end of input instead of
+    // allocating memory for 2^63 items
+    {
+        Buffer b;
+        serialize(b, uint64_t(1) << 63, 1, 2, 3);
+        Reader r(b);
+        try {
+            deserialize<std::vector<int> >(r);
+        }
+        catch (std::runtime_error& e) {
+            std::cout << "corrupt length: " << e.what() << std::endl;
+        }
+    }
+
+    // stream records into a FileIo, and compare with text formatting
+    {
+        const size_t records = 1000000;
+
+        CountingFile file;
+        Buffer b;
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < records; ++i) {
+            serialize(b, i, static_cast<int>(i % 100) - 50, i * 0.5,
+                      std::string("event"));
+            // flush to the file in large blocks
+            if (b.size() >= 64 * 1024) {
+                file.write(b.data(), b.size());
+                b.clear();
+            }
+        }
+        file.write(b.data(), b.size());
+        auto middle = std::chrono::steady_clock::now();
+
+        std::ostringstream oss;
+        for (size_t i = 0; i < records; ++i) {
+            oss << i << ' ' << static_cast<int>(i % 100) - 50 << ' '
+                << i * 0.5 << " event\n";
+        }
+        auto stop = std::chrono::steady_clock::now();
+
+        double t_binary =
+            std::chrono::duration<double, std::nano>(middle - start).count();
+        double t_text =
+            std::chrono::duration<double, std::nano>(stop - middle).count();
+
+        std::cout << "binary: " << file.bytes() << " bytes, "
+                  << t_binary / records << " ns/record" << std::endl;
+        std::cout << "text:   " << oss.str().size() << " bytes, "
+                  << t_text / records << " ns/record" << std::endl;
+    }
+
+    return 0;
+}
@@ -0,0 +1,391 @@
+// work-stealing thread pool executing move-only closures
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+//! A non-copyable move-only buffer which contains a "large" memory area
+class Buffer {
+public:
+    //! allocate buffer containing n bytes
+    explicit Buffer(size_t n)
+        : data_(reinterpret_cast<char*>(operator new(n))), size_(n) {}
+
+    //! allocate buffer containing string str
+    explicit Buffer(const char* str) : Buffer(strlen(str)) {
+        std::copy(str, str + size_, data_);
+    }
+
+    //! non-copyable: delete copy-constructor
+    Buffer(const Buffer&) = delete;
+    //! non-copyable: delete assignment operator
+    Buffer& operator=(const Buffer&) = delete;
+
+    //! move-construct other buffer into this one
+    Buffer(Buffer&& other) noexcept : data_(other.data_), size_(other.size_) {
+        other.data_ = nullptr;
+        other.size_ = 0;
+    }
+
+    //! move-assignment of other buffer into this one
+    Buffer& operator=(Buffer&& other) noexcept {
+        if (this == &other)
+            return *this;
+
+        operator delete(data_);
+        data_ = other.data_;
+        size_ = other.size_;
+        other.data_ = nullptr;
+        other.size_ = 0;
+
+        return *this;
+    }
+
+    //! delete buffer
+    ~Buffer() { operator delete(data_); }
+
+    //! return as string
+    std::string to_string() const { return std::string(data_, size_); }
+
+    //! pointer to the buffer's memory
+    char* data() { return data_; }
+
+    //! pointer to the buffer's memory
+    const char* data() const { return data_; }
+
+    //! size of the buffer
+    size_t size() const { return size_; }
+
+private:
+    //! the buffer
+    char* data_;
+    //! buffer size
+    size_t size_;
+};
+
+//! "long" version of a lambda: a functor owning a Buffer
+class Functor
+{
+public:
+    Functor(Buffer&& b1) : b1(std::move(b1)) { }
+
+    void operator () () const {
+        std::cout << b1.to_string() << std::endl;
+    }
+
+private:
+    Buffer b1;
+};
+
+/******************************************************************************/
+
+//! A move-only void() callable. Unlike std::function it can hold closures
+//! which own move-only objects like Buffer. This is the simplest type erasure
+//! via a virtual base class, see unique-function.cpp for a version which
+//! avoids the heap allocation for small closures.
+class Task {
+public:
+    Task() = default;
+
+    template <typename Functor, typename = typename std::enable_if<
+                  !std::is_same<typename std::decay<Functor>::type,
+                                Task>::value>::type>
+    Task(Functor&& f)
+        : impl_(new Impl<typename std::decay<Functor>::type>(
+                    std::forward<Functor>(f))) {}
+
+    void operator () () { impl_->run(); }
+
+    explicit operator bool() const { return impl_ != nullptr; }
+
+private:
+    struct Base {
+        virtual ~Base() = default;
+        virtual void run() = 0;
+    };
+
+    template <typename Functor>
+    struct Impl final : public Base {
+        explicit Impl(Functor&& f) : f_(std::move(f)) {}
+        explicit Impl(const Functor& f) : f_(f) {}
+        void run() final { f_(); }
+        Functor f_;
+    };
+
+    std::unique_ptr<Base> impl_;
+};
+
+//! Minimal allocator returning memory aligned to alignof(Type). Before C++17,
+//! std::allocator ignores alignments above that of max_align_t, hence a
+//! std::vector of over-aligned elements needs this.
+template <typename Type>
+class AlignedAllocator {
+public:
+    using value_type = Type;
+
+    AlignedAllocator() = default;
+    template <typename Other>
+    AlignedAllocator(const AlignedAllocator<Other>&) {}
+
+    Type* allocate(size_t n) {
+        void* p;
+        if (posix_memalign(&p, std::max(alignof(Type), sizeof(void*)),
+                           n * sizeof(Type)) != 0)
+            throw std::bad_alloc();
+        return static_cast<Type*>(p);
+    }
+
+    void deallocate(Type* p, size_t /* n */) { std::free(p); }
+
+    template <typename Other>
+    bool operator == (const AlignedAllocator<Other>&) const { return true; }
+    template <typename Other>
+    bool operator != (const AlignedAllocator<Other>&) const { return false; }
+};
+
+//! A thread pool in which each worker owns a deque of tasks. Workers push and
+//! pop their own tasks at the back (LIFO, cache-warm), and idle workers steal
+//! from the front of other deques (FIFO, the oldest and usually largest
+//! tasks). Tasks submitted from outside the pool are distributed round-robin.
+//! Each deque has its own mutex, hence workers contend only when stealing.
+class ThreadPool {
+public:
+    //! start the given number of worker threads
+    explicit ThreadPool(
+        size_t num_threads = std::max(1u, std::thread::hardware_concurrency()))
+        : queues_(num_threads) {
+        for (size_t i = 0; i < num_threads; ++i)
+            threads_.emplace_back([this, i]() { worker(i); });
+    }
+
+    //! non-copyable: delete copy-constructor
+    ThreadPool(const ThreadPool&) = delete;
+    //! non-copyable: delete assignment operator
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    //! wait for all tasks, then stop the workers
+    ~ThreadPool() {
+        wait();
+        {
+            std::lock_guard<std::mutex> lock(sleep_mutex_);
+            terminate_ = true;
+        }
+        sleep_cv_.notify_all();
+        for (std::thread& t : threads_)
+            t.join();
+    }
+
+    //! submit a task, which is moved into the pool
+    void submit(Task&& task) {
+        pending_.fetch_add(1, std::memory_order_relaxed);
+
+        // workers push to their own deque, others round-robin
+        size_t i = (tls_pool_ == this)
+                   ? tls_index_ : next_.fetch_add(1) % queues_.size();
+        {
+            std::lock_guard<std::mutex> lock(queues_[i].mutex);
+            queues_[i].tasks.emplace_back(std::move(task));
+        }
+
+        // increment before taking the lock, which the sleeping side checks
+        // under the lock: no wakeup is lost.
+        queued_.fetch_add(1, std::memory_order_release);
+        { std::lock_guard<std::mutex> lock(sleep_mutex_); }
+        sleep_cv_.notify_one();
+    }
+
+    //! block until all submitted tasks have finished
+    void wait() {
+        std::unique_lock<std::mutex> lock(done_mutex_);
+        done_cv_.wait(lock, [this]() { return pending_.load() == 0; });
+    }
+
+    //! number of worker threads
+    size_t size() const { return threads_.size(); }
+
+    //! number of tasks stolen so far
+    size_t steals() const { return steals_.load(); }
+
+private:
+    //! one worker's deque, padded to avoid false sharing between workers
+    struct alignas(64) Queue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    //! pop from the back of worker i's own deque
+    bool pop_local(size_t i, Task& task) {
+        std::lock_guard<std::mutex> lock(queues_[i].mutex);
+        if (queues_[i].tasks.empty())
+            return false;
+        task = std::move(queues_[i].tasks.back());
+        queues_[i].tasks.pop_back();
+        return true;
+    }
+
+    //! steal from the front of another worker's deque
+    bool steal(size_t i, Task& task) {
+        for (size_t k = 1; k < queues_.size(); ++k) {
+            Queue& q = queues_[(i + k) % queues_.size()];
+            std::lock_guard<std::mutex> lock(q.mutex);
+            if (q.tasks.empty())
+                continue;
+            task = std::move(q.tasks.front());
+            q.tasks.pop_front();
+            steals_.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+        return false;
+    }
+
+    //! worker thread main loop
+    void worker(size_t i) {
+        tls_pool_ = this;
+        tls_index_ = i;
+
+        for ( ; ; ) {
+            Task task;
+            if (pop_local(i, task) || steal(i, task)) {
+                queued_.fetch_sub(1, std::memory_order_relaxed);
+                task();
+                // destroy the closure (and its Buffers) before signaling
+                task = Task();
+                if (pending_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                    { std::lock_guard<std::mutex> lock(done_mutex_); }
+                    done_cv_.notify_all();
+                }
+                continue;
+            }
+
+            std::unique_lock<std::mutex> lock(sleep_mutex_);
+            sleep_cv_.wait(lock, [this]() {
+                return terminate_ || queued_.load(std::memory_order_acquire);
+            });
+            if (terminate_)
+                return;
+        }
+    }
+
+    //! per-worker deques, each on its own cache lines
+    std::vector<Queue, AlignedAllocator<Queue> > queues_;
+    //! worker threads
+    std::vector<std::thread> threads_;
+
+    //! tasks submitted but not finished
+    std::atomic<size_t> pending_ { 0 };
+    //! tasks sitting in some deque
+    std::atomic<size_t> queued_ { 0 };
+    //! round-robin counter for external submissions
+    std::atomic<size_t> next_ { 0 };
+    //! statistics: number of stolen tasks
+    std::atomic<size_t> steals_ { 0 };
+
+    //! idle workers sleep here
+    std::mutex sleep_mutex_;
+    std::condition_variable sleep_cv_;
+    bool terminate_ = false;
+
+    //! wait() sleeps here
+    std::mutex done_mutex_;
+    std::condition_variable done_cv_;
+
+    //! pool and index of the current worker thread
+    static thread_local ThreadPool* tls_pool_;
+    static thread_local size_t tls_index_;
+};
+
+thread_local ThreadPool* ThreadPool::tls_pool_ = nullptr;
+thread_local size_t ThreadPool::tls_index_ = 0;
+
+/******************************************************************************/
+
+//! checksum of a buffer, the unit of work in the benchmark
+uint64_t checksum(const Buffer& b) {
+    uint64_t sum = 0;
+    for (size_t i = 0; i < b.size(); ++i)
+        sum = sum * 131 + static_cast<unsigned char>(b.data()[i]);
+    return sum;
+}
+
+//! recursively split [begin, end) into tasks, as divide-and-conquer
+//! algorithms do: stealing balances the unevenly sized subtrees.
+void spawn_tree(ThreadPool& pool, std::atomic<uint64_t>& result,
+                size_t begin, size_t end) {
+    if (end - begin <= 4) {
+        Buffer b(4096);
+        std::memset(b.data(), static_cast<int>(begin), b.size());
+        result += checksum(b);
+        return;
+    }
+    size_t mid = begin + (end - begin) / 3;
+    pool.submit([&pool, &result, begin, mid]() {
+        spawn_tree(pool, result, begin, mid);
+    });
+    spawn_tree(pool, result, mid, end);
+}
+
+int main() {
+    // closures and functors owning Buffers are moved into the pool
+    {
+        ThreadPool pool(2);
+
+        Buffer bl("lambda buffer");
+        pool.submit([bl = std::move(bl)]() {
+            std::cout << bl.to_string() << std::endl;
+        });
+        pool.wait();
+
+        pool.submit(Functor(Buffer("functor buffer")));
+        pool.wait();
+    }
+
+    // scaling: independent Buffer-owning tasks, and a recursive task tree
+    size_t max_threads = std::max(2u, std::thread::hardware_concurrency());
+    for (size_t threads = 1; threads <= max_threads; threads *= 2) {
+        ThreadPool pool(threads);
+        std::atomic<uint64_t> result { 0 };
+
+        auto start = std::chrono::steady_clock::now();
+
+        for (size_t i = 0; i < 20000; ++i) {
+            Buffer b(4096);
+            std::memset(b.data(), static_cast<int>(i), b.size());
+            pool.submit([b = std::move(b), &result]() {
+                result += checksum(b);
+            });
+        }
+        pool.wait();
+
+        auto middle = std::chrono::steady_clock::now();
+
+        pool.submit([&pool, &result]() {
+            spawn_tree(pool, result, 0, 80000);
+        });
+        pool.wait();
+
+        auto stop = std::chrono::steady_clock::now();
+
+        std::cout << "threads=" << threads << " independent: "
+                  << std::chrono::duration<double>(middle - start).count()
+                  << " s, tree: "
+                  << std::chrono::duration<double>(stop - middle).count()
+                  << " s, steals=" << pool.steals() << std::endl;
+    }
+
+    return 0;
+}
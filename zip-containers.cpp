@@ -0,0 +1,216 @@
+// zip over a pack of containers: zero-copy zipped views, lock-step loops over
+// raw arrays and parallel chunked traversal
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+//! minimum size of a pack of containers, the length of their zip
+template <typename... Containers>
+size_t zip_size(const Containers&... containers) {
+    size_t sizes[] = { containers.size()..., 0 };
+    size_t n = sizes[0];
+    for (size_t i = 1; i < sizeof...(Containers); ++i)
+        n = std::min(n, sizes[i]);
+    return n;
+}
+
+/******************************************************************************/
+
+//! A zipped view of a pack of containers: element i is a tuple of references
+//! to the i-th elements of all containers. Nothing is copied, neither the
+//! containers nor their elements, unlike building a std::vector of
+//! std::tuple<typename Types::value_type...>. The length is that of the
+//! shortest container.
+template <typename... Containers>
+class ZipView {
+public:
+    //! tuple of references to the elements at one index
+    using reference = std::tuple<decltype(
+        std::declval<Containers&>()[0])...>;
+
+    explicit ZipView(Containers&... containers)
+        : containers_(containers...), size_(zip_size(containers...)) {}
+
+    size_t size() const { return size_; }
+
+    reference operator [] (size_t i) const {
+        return at(i, std::index_sequence_for<Containers...>());
+    }
+
+    class iterator {
+    public:
+        iterator(const ZipView* v, size_t i) : v_(v), i_(i) {}
+
+        reference operator * () const { return (*v_)[i_]; }
+        iterator& operator ++ () { ++i_; return *this; }
+        bool operator != (const iterator& o) const { return i_ != o.i_; }
+
+    private:
+        const ZipView* v_;
+        size_t i_;
+    };
+
+    iterator begin() const { return iterator(this, 0); }
+    iterator end() const { return iterator(this, size_); }
+
+private:
+    template <size_t... Is>
+    reference at(size_t i, std::index_sequence<Is...>) const {
+        return reference(std::get<Is>(containers_)[i]...);
+    }
+
+    std::tuple<Containers&...> containers_;
+    size_t size_;
+};
+
+//! construct a ZipView, inferring the container types
+template <typename... Containers>
+ZipView<Containers...> zip(Containers&... containers) {
+    return ZipView<Containers...>(containers...);
+}
+
+/******************************************************************************/
+// lock-step loops. The containers must be contiguous (provide .data()). The
+// loop runs over a pack of raw pointers and passes one element of each to f,
+// which is inlined: for arithmetic f this is a plain array loop, which the
+// compiler can vectorize (with -O3, after a runtime check that the arrays do
+// not overlap).
+
+template <typename Functor, typename Pointers, size_t... Is>
+void zip_loop(Functor& f, const Pointers& ptrs, size_t begin, size_t end,
+              std::index_sequence<Is...>) {
+    for (size_t i = begin; i < end; ++i)
+        f(std::get<Is>(ptrs)[i]...);
+}
+
+//! call f(a[i], b[i], ...) for each index i of the zip of containers a, b, ...
+template <typename Functor, typename... Containers>
+void zip_for_each(Functor&& f, Containers&... containers) {
+    zip_loop(f, std::make_tuple(containers.data()...),
+             0, zip_size(containers...),
+             std::index_sequence_for<Containers...>());
+}
+
+//! like zip_for_each(), but split the index range into one chunk per thread.
+//! Chunks are multiples of 64 elements, hence threads write to the same cache
+//! lines at most at chunk boundaries, and not at all if the arrays are 64-byte
+//! aligned, which std::vector does not guarantee. Small ranges run in fewer
+//! threads. f is called concurrently and must only modify the elements it is
+//! passed.
+template <typename Functor, typename... Containers>
+void parallel_zip_for_each(
+    size_t num_threads, Functor&& f, Containers&... containers) {
+    size_t n = zip_size(containers...);
+    auto ptrs = std::make_tuple(containers.data()...);
+
+    size_t per_thread = (n + std::max<size_t>(num_threads, 1) - 1)
+                        / std::max<size_t>(num_threads, 1);
+    size_t chunk = std::max<size_t>(64, (per_thread + 63) / 64 * 64);
+    std::vector<std::thread> threads;
+    for (size_t begin = chunk; begin < n; begin += chunk) {
+        size_t end = std::min(begin + chunk, n);
+        threads.emplace_back([&f, &ptrs, begin, end]() {
+            zip_loop(f, ptrs, begin, end,
+                     std::index_sequence_for<Containers...>());
+        });
+    }
+    // the calling thread processes the first chunk
+    zip_loop(f, ptrs, 0, std::min(chunk, n),
+             std::index_sequence_for<Containers...>());
+    for (std::thread& t : threads)
+        t.join();
+}
+
+/******************************************************************************/
+
+//! run f and return milliseconds
+template <typename Functor>
+double time_ms(Functor f) {
+    auto start = std::chrono::steady_clock::now();
+    f();
+    auto stop = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::milli>(stop - start).count();
+}
+
+int main() {
+    {
+        std::vector<int> ids{ 1, 2, 3 };
+        std::vector<std::string> names{ "one", "two", "three", "four" };
+        std::vector<double> values{ 1.5, 2.5, 3.5 };
+
+        // zipped view: element-wise references, no copies
+        for (auto row : zip(ids, names, values)) {
+            std::get<2>(row) *= 2;
+            std::cout << std::get<0>(row) << " " << std::get<1>(row) << " "
+                      << std::get<2>(row) << std::endl;
+        }
+
+        zip_for_each([](int& id, const std::string& name) {
+            id += static_cast<int>(name.size());
+        }, ids, names);
+        std::cout << "ids: " << ids[0] << " " << ids[1] << " " << ids[2]
+                  << std::endl;
+
+        // fewer elements than threads, and zero threads: one chunk, run by
+        // the calling thread
+        parallel_zip_for_each(8, [](int& id) { id *= 10; }, ids);
+        parallel_zip_for_each(0, [](int& id) { id += 1; }, ids);
+        std::cout << "ids: " << ids[0] << " " << ids[1] << " " << ids[2]
+                  << std::endl;
+    }
+
+    // multi-column transform: out = a * b + c
+    const size_t n = 16 * 1024 * 1024;
+    std::vector<float> a(n), b(n), c(n), out(n);
+    for (size_t i = 0; i < n; ++i) {
+        a[i] = static_cast<float>(i % 1000);
+        b[i] = 0.5f;
+        c[i] = static_cast<float>(i % 7);
+    }
+    auto kernel = [](float& o, float x, float y, float z) { o = x * y + z; };
+
+    double t_materialize = time_ms([&]() {
+        // the approach of test1(): copy into intermediate tuples
+        std::vector<std::tuple<float, float, float> > rows;
+        rows.reserve(n);
+        for (size_t i = 0; i < n; ++i)
+            rows.emplace_back(a[i], b[i], c[i]);
+        for (size_t i = 0; i < n; ++i) {
+            kernel(out[i], std::get<0>(rows[i]), std::get<1>(rows[i]),
+                   std::get<2>(rows[i]));
+        }
+    });
+    float check1 = out[n - 1];
+
+    double t_view = time_ms([&]() {
+        for (auto row : zip(out, a, b, c)) {
+            kernel(std::get<0>(row), std::get<1>(row), std::get<2>(row),
+                   std::get<3>(row));
+        }
+    });
+
+    double t_loop = time_ms([&]() { zip_for_each(kernel, out, a, b, c); });
+
+    size_t threads = std::max(1u, std::thread::hardware_concurrency());
+    double t_parallel = time_ms([&]() {
+        parallel_zip_for_each(threads, kernel, out, a, b, c);
+    });
+
+    std::cout << "out = a * b + c over " << n << " floats, ms:"
+              << " materialized tuples=" << t_materialize
+              << " zip view=" << t_view
+              << " zip_for_each=" << t_loop
+              << " parallel (" << threads << " threads)=" << t_parallel
+              << " (" << (check1 == out[n - 1] ? "equal" : "DIFFER") << ")"
+              << std::endl;
+
+    return 0;
+}